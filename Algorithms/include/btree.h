@@ -0,0 +1,774 @@
+#define GEN_PREFIX btree
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "throw.h"
+
+// Additional parameters :
+// BTREE_NODE : Maximum number of keys in a node, at least 4 (default: 64 for keys up to 4 bytes, 32 up to 8 bytes, 16 otherwise)
+// Keys in a node are scanned linearly without branches, so expensive comparisons should use a smaller BTREE_NODE
+
+#ifndef BTREE_NODE
+#define BTREE_NODE (sizeof(GEN_KEY) <= 4 ? 64 : sizeof(GEN_KEY) <= 8 ? 32 : 16)
+#endif
+
+// Minimum number of items in a leaf and of keys in an inner node, except for the root
+#define BTREE_LEAF_MIN (BTREE_NODE / 2)
+#define BTREE_INNER_MIN ((BTREE_NODE - 1) / 2)
+
+// Stack size (every inner node has at least 2 children)
+#define BTREE_STACK (sizeof(GEN_SIZE) * CHAR_BIT)
+
+
+/**
+ * @brief B+tree leaf, leaf 0 is always the first leaf
+ * @param length Number of items in the leaf
+ * @param next Index of the next leaf, -1 if last leaf
+ * Can also be the index of the next reusable leaf if the leaf is reusable
+ * @param items Items in the leaf, sorted by key
+**/
+typedef struct {
+    GEN_SIZE length;
+    GEN_SIZE next;
+    GEN_KV_TYPE items[BTREE_NODE];
+} GEN_NAME_(leaf);
+
+
+/**
+ * @brief B+tree inner node
+ * @param length Number of keys in the node
+ * @param keys Sorted keys, keys[i] is smaller or equal to the keys in children[i + 1]
+ * and greater than the keys in children[i]
+ * @param children Indices of the children (inner nodes or leaves depending on the height)
+ * children[0] can also be the index of the next reusable node if the node is reusable
+**/
+typedef struct {
+    GEN_SIZE length;
+    GEN_KEY keys[BTREE_NODE];
+    GEN_SIZE children[BTREE_NODE + 1];
+} GEN_NAME_(inner);
+
+
+/**
+ * @brief B+tree, items are stored in linked leaves
+ * @param leaves Leaves of the tree
+ * @param inners Inner nodes of the tree
+ * @param root Index of the root (a leaf if [height] is 0, an inner node otherwise)
+ * @param height Number of inner nodes from the root to a leaf
+ * @param length Number of items in the tree
+ * @param leafCount, innerCount Number of used or reusable nodes in [leaves] and [inners]
+ * @param leafCapacity, innerCapacity Size of [leaves] and [inners]
+ * @param reusableLeaf, reusableInner Index of the first reusable node in [leaves] and [inners]
+ * @param removed Value of the last removed item
+**/
+typedef struct {
+    GEN_NAME_(leaf)* leaves;
+    GEN_NAME_(inner)* inners;
+    GEN_SIZE root;
+    int height;
+    GEN_SIZE length;
+    GEN_SIZE leafCount;
+    GEN_SIZE leafCapacity;
+    GEN_SIZE reusableLeaf;
+    GEN_SIZE innerCount;
+    GEN_SIZE innerCapacity;
+    GEN_SIZE reusableInner;
+#ifndef GEN_NO_VALUE
+    GEN_TYPE removed;
+#endif
+} GEN_ALGO;
+
+
+/**
+ * @brief B+tree iterator
+**/
+typedef struct {
+    GEN_SIZE leaf;
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Initialize a B+tree
+ * @param tree The tree
+ * @param capacity Initial capacity
+**/
+inline void GEN_NAME(init)(GEN_ALGO* tree, GEN_SIZE capacity) {
+    tree->leafCapacity = capacity / BTREE_LEAF_MIN + 1;
+    tree->leaves = THROW_PN(malloc(sizeof(GEN_NAME_(leaf)) * tree->leafCapacity), tree->leaves);
+    tree->leaves[0].length = 0;
+    tree->leaves[0].next = GEN_NONE;
+    tree->innerCapacity = tree->leafCapacity / BTREE_INNER_MIN + 1;
+    tree->inners = THROW_PN(malloc(sizeof(GEN_NAME_(inner)) * tree->innerCapacity), tree->inners);
+    tree->root = 0;
+    tree->height = 0;
+    tree->length = 0;
+    tree->leafCount = 1;
+    tree->reusableLeaf = GEN_NONE;
+    tree->innerCount = 0;
+    tree->reusableInner = GEN_NONE;
+}
+
+
+/**
+ * @brief Create a B+tree
+ * @param capacity Initial capacity
+ * @return The tree
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
+    GEN_ALGO tree;
+    GEN_NAME(init)(&tree, capacity);
+    return tree;
+}
+
+
+/**
+ * @brief Free a B+tree
+ * @param tree The tree
+**/
+inline void GEN_NAME(free)(GEN_ALGO* tree) {
+    free(tree->leaves);
+    free(tree->inners);
+}
+
+
+// Index of the child of an inner node that can contain a key (number of keys smaller or equal to the key)
+inline GEN_SIZE GEN_NAME_(innerPos)(GEN_NAME_(inner)* node, GEN_KEY key) {
+    GEN_SIZE pos = 0;
+    for (GEN_SIZE i = 0; i < node->length; i++) pos += GEN_COMPARE(key, node->keys[i]) >= 0;
+    return pos;
+}
+
+
+// Index of the first item of a leaf with a key greater or equal to a key (number of smaller keys)
+inline GEN_SIZE GEN_NAME_(leafPos)(GEN_NAME_(leaf)* leaf, GEN_KEY key) {
+    GEN_SIZE pos = 0;
+    for (GEN_SIZE i = 0; i < leaf->length; i++) pos += GEN_COMPARE(key, GEN_KV_KEY(leaf->items[i])) > 0;
+    return pos;
+}
+
+
+// Index of the leaf that can contain a key
+inline GEN_SIZE GEN_NAME_(findLeaf)(GEN_ALGO* tree, GEN_KEY key) {
+    GEN_SIZE index = tree->root;
+    for (int h = tree->height; h > 0; h--) {
+        GEN_NAME_(inner)* node = tree->inners + index;
+        index = node->children[GEN_NAME_(innerPos)(node, key)];
+    }
+    return index;
+}
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Get an item in a B+tree
+ * @param tree The tree
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added or removed item), NULL if not found
+**/
+inline GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* tree, GEN_KEY key) {
+    GEN_NAME_(leaf)* leaf = tree->leaves + GEN_NAME_(findLeaf)(tree, key);
+    GEN_SIZE pos = GEN_NAME_(leafPos)(leaf, key);
+    if (pos < leaf->length && GEN_COMPARE(key, leaf->items[pos].key) == 0) return &leaf->items[pos].value;
+    return NULL;
+}
+
+
+/**
+ * @brief Get an item in a B+tree or create it if not found
+ * @param tree The tree
+ * @param key Key of the item
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added or removed item)
+**/
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* tree, GEN_KEY key, bool* added);
+
+
+/**
+ * @brief Get an item in a B+tree or create it with a default value if not found
+ * @param tree The tree
+ * @param key Key of the item
+ * @param value Default value
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added or removed item)
+**/
+inline GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value, bool* added) {
+    bool _added;
+    GEN_TYPE* pValue = GEN_NAME(refOrEmpty)(tree, key, &_added);
+    if (_added) *pValue = value;
+    if (added) *added = _added;
+    return pValue;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a B+tree if found (undefined otherwise)
+ * @param tree The tree
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* tree, GEN_KEY key) {
+    return *GEN_NAME(ref)(tree, key);
+}
+
+
+/**
+ * @brief Get the value associated with a key in a B+tree if found or a default value otherwise
+ * @param tree The tree
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(tree, key);
+    return pValue == NULL ? value : *pValue;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a B+tree if found or create a new item with that value otherwise
+ * @param tree The tree
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(setOrAdd)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    *GEN_NAME(refOrEmpty)(tree, key, &added) = value;
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Check whether a B+tree contains a key
+ * @param tree The tree
+ * @param key The key
+ * @return true if the key was found, false otherwise
+**/
+#ifdef GEN_NO_VALUE
+inline bool GEN_NAME(contains)(GEN_ALGO* tree, GEN_KEY key) {
+    GEN_NAME_(leaf)* leaf = tree->leaves + GEN_NAME_(findLeaf)(tree, key);
+    GEN_SIZE pos = GEN_NAME_(leafPos)(leaf, key);
+    return pos < leaf->length && GEN_COMPARE(key, leaf->items[pos]) == 0;
+}
+#else
+inline bool GEN_NAME(contains)(GEN_ALGO* tree, GEN_KEY key) {
+    return GEN_NAME(ref)(tree, key) != NULL;
+}
+#endif
+
+
+/**
+ * @brief Add an item in a B+tree if it does not already exist
+ * @param tree The tree
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* tree, GEN_KEY key);
+#else
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(refOrDefault)(tree, key, value, &added);
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Remove an item in a B+tree if found
+ * @param tree The tree
+ * @param key Key of the item
+ * @return Pointer to the value of the removed item (usable until next removed item), NULL if not found
+**/
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* tree, GEN_KEY key);
+
+
+/**
+ * @brief Start iterating on a B+tree
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterAll)(void) {
+    GEN_NAME(iter) iter;
+    iter.leaf = 0;
+    iter.index = 0;
+    return iter;
+}
+
+
+/**
+ * @brief Start iterating on a sub-tree
+ * @param tree The tree
+ * @param start Start key of the sub-tree (inclusive)
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start) {
+    GEN_NAME(iter) iter;
+    iter.leaf = GEN_NAME_(findLeaf)(tree, start);
+    iter.index = GEN_NAME_(leafPos)(tree->leaves + iter.leaf, start);
+    return iter;
+}
+
+
+/**
+ * @brief Start iterating on a sub-tree
+ * @param tree The tree
+ * @param end End key of the sub-tree (exclusive)
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterBefore)(GEN_ALGO* tree, GEN_KEY end) {
+    return GEN_NAME(iterAll)();
+}
+
+
+/**
+ * @brief Start iterating on a sub-tree
+ * @param tree The tree
+ * @param start Start key of the sub-tree (inclusive)
+ * @param end End key of the sub-tree (exclusive)
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end) {
+    return GEN_NAME(iterAfter)(tree, start);
+}
+
+
+/**
+ * @brief Get the next item while iterating on a B+tree
+ * @param tree The tree
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter) {
+    GEN_NAME_(leaf)* leaf = tree->leaves + iter->leaf;
+    while (iter->index >= leaf->length) {
+        if (leaf->next == GEN_NONE) return NULL;
+        iter->leaf = leaf->next;
+        iter->index = 0;
+        leaf = tree->leaves + iter->leaf;
+    }
+    return &leaf->items[iter->index++];
+}
+
+
+/**
+ * @brief Get the next item while iterating on a sub-tree
+ * @param tree The tree
+ * @param start Start key of the sub-tree (inclusive)
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(nextAfter)(GEN_ALGO* tree, GEN_KEY start, GEN_NAME(iter)* iter) {
+    return GEN_NAME(nextAll)(tree, iter);
+}
+
+
+/**
+ * @brief Get the next item while iterating on a sub-tree
+ * @param tree The tree
+ * @param end End key of the sub-tree (exclusive)
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(nextBefore)(GEN_ALGO* tree, GEN_KEY end, GEN_NAME(iter)* iter) {
+    GEN_KV_TYPE* kv = GEN_NAME(nextAll)(tree, iter);
+    if (kv == NULL || GEN_COMPARE(GEN_KV_KEY(*kv), end) >= 0) return NULL;
+    return kv;
+}
+
+
+/**
+ * @brief Get the next item while iterating on a sub-tree
+ * @param tree The tree
+ * @param start Start key of the sub-tree (inclusive)
+ * @param end End key of the sub-tree (exclusive)
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(nextBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end, GEN_NAME(iter)* iter) {
+    return GEN_NAME(nextBefore)(tree, end, iter);
+}
+
+
+/**
+ * @brief Get the closest item with a key smaller or equal to a given key in a B+tree
+ * @param tree The tree
+ * @param key The key
+ * @return The item, NULL if not found
+**/
+GEN_KV_TYPE* GEN_NAME(floor)(GEN_ALGO* tree, GEN_KEY key);
+
+
+/**
+ * @brief Get the closest item with a key greater or equal to a given key in a B+tree
+ * @param tree The tree
+ * @param key The key
+ * @return The item, NULL if not found
+**/
+GEN_KV_TYPE* GEN_NAME(ceil)(GEN_ALGO* tree, GEN_KEY key);
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* tree, GEN_SIZE capacity);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* tree);
+GEN_SIZE GEN_NAME_(innerPos)(GEN_NAME_(inner)* node, GEN_KEY key);
+GEN_SIZE GEN_NAME_(leafPos)(GEN_NAME_(leaf)* leaf, GEN_KEY key);
+GEN_SIZE GEN_NAME_(findLeaf)(GEN_ALGO* tree, GEN_KEY key);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* tree, GEN_KEY key);
+GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value, bool* added);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* tree, GEN_KEY key);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(setOrAdd)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(tryAdd)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value);
+#endif
+bool GEN_NAME(contains)(GEN_ALGO* tree, GEN_KEY key);
+GEN_NAME(iter) GEN_NAME(iterAll)();
+GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start);
+GEN_NAME(iter) GEN_NAME(iterBefore)(GEN_ALGO* tree, GEN_KEY end);
+GEN_NAME(iter) GEN_NAME(iterBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end);
+GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter);
+GEN_KV_TYPE* GEN_NAME(nextAfter)(GEN_ALGO* tree, GEN_KEY start, GEN_NAME(iter)* iter);
+GEN_KV_TYPE* GEN_NAME(nextBefore)(GEN_ALGO* tree, GEN_KEY end, GEN_NAME(iter)* iter);
+GEN_KV_TYPE* GEN_NAME(nextBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end, GEN_NAME(iter)* iter);
+
+
+/**
+ * @brief Position of a node in its parent
+ * @param index Index of the parent
+ * @param pos Index of the node in the children of the parent
+**/
+typedef struct {
+    GEN_SIZE index;
+    GEN_SIZE pos;
+} GEN_NAME_(path);
+
+
+// Get a new leaf
+static GEN_SIZE GEN_NAME_(newLeaf)(GEN_ALGO* tree) {
+    GEN_SIZE i = tree->reusableLeaf;
+    if (i != GEN_NONE) {
+        tree->reusableLeaf = tree->leaves[i].next;
+        return i;
+    }
+    if (tree->leafCount == tree->leafCapacity) {
+        GEN_GROW(tree->leafCapacity);
+        tree->leaves = THROW_PN(realloc(tree->leaves, sizeof(GEN_NAME_(leaf)) * tree->leafCapacity), tree->leaves);
+    }
+    return tree->leafCount++;
+}
+
+
+// Get a new inner node
+static GEN_SIZE GEN_NAME_(newInner)(GEN_ALGO* tree) {
+    GEN_SIZE i = tree->reusableInner;
+    if (i != GEN_NONE) {
+        tree->reusableInner = tree->inners[i].children[0];
+        return i;
+    }
+    if (tree->innerCount == tree->innerCapacity) {
+        GEN_GROW(tree->innerCapacity);
+        tree->inners = THROW_PN(realloc(tree->inners, sizeof(GEN_NAME_(inner)) * tree->innerCapacity), tree->inners);
+    }
+    return tree->innerCount++;
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* tree, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* tree, GEN_KEY key, bool* added) {
+#endif
+    GEN_NAME_(path) path[BTREE_STACK];
+
+    // Find item
+    GEN_SIZE index = tree->root;
+    for (int h = tree->height; h > 0; h--) {
+        GEN_NAME_(inner)* node = tree->inners + index;
+        GEN_SIZE pos = GEN_NAME_(innerPos)(node, key);
+        path[h].index = index;
+        path[h].pos = pos;
+        index = node->children[pos];
+    }
+    GEN_NAME_(leaf)* leaf = tree->leaves + index;
+    GEN_SIZE pos = GEN_NAME_(leafPos)(leaf, key);
+    if (pos < leaf->length && GEN_COMPARE(key, GEN_KV_KEY(leaf->items[pos])) == 0) {
+#ifdef GEN_NO_VALUE
+        return false;
+#else
+        if (added) *added = false;
+        return &leaf->items[pos].value;
+#endif
+    }
+    tree->length++;
+
+    // Split leaf if full
+    GEN_SIZE splitIndex = GEN_NONE;
+    if (leaf->length == BTREE_NODE) {
+        splitIndex = GEN_NAME_(newLeaf)(tree);
+        leaf = tree->leaves + index;
+        GEN_NAME_(leaf)* split = tree->leaves + splitIndex;
+        split->length = BTREE_NODE - BTREE_LEAF_MIN;
+        memcpy(split->items, leaf->items + BTREE_LEAF_MIN, sizeof(GEN_KV_TYPE) * split->length);
+        split->next = leaf->next;
+        leaf->length = BTREE_LEAF_MIN;
+        leaf->next = splitIndex;
+        if (pos > BTREE_LEAF_MIN) {
+            leaf = split;
+            pos -= BTREE_LEAF_MIN;
+        }
+    }
+
+    // Add item
+    memmove(leaf->items + pos + 1, leaf->items + pos, sizeof(GEN_KV_TYPE) * (leaf->length - pos));
+    GEN_KV_KEY(leaf->items[pos]) = key;
+    leaf->length++;
+#ifndef GEN_NO_VALUE
+    GEN_TYPE* value = &leaf->items[pos].value;
+#endif
+
+    // Add split nodes to parents
+    if (splitIndex != GEN_NONE) {
+        GEN_KEY splitKey = GEN_KV_KEY(tree->leaves[splitIndex].items[0]);
+        int h = 1;
+        for (; h <= tree->height; h++) {
+            GEN_NAME_(inner)* node = tree->inners + path[h].index;
+            GEN_SIZE p = path[h].pos;
+            if (node->length < BTREE_NODE) {
+                memmove(node->keys + p + 1, node->keys + p, sizeof(GEN_KEY) * (node->length - p));
+                memmove(node->children + p + 2, node->children + p + 1, sizeof(GEN_SIZE) * (node->length - p));
+                node->keys[p] = splitKey;
+                node->children[p + 1] = splitIndex;
+                node->length++;
+                break;
+            }
+
+            // Split inner node, the middle key moves to the parent
+            GEN_KEY keys[BTREE_NODE + 1];
+            GEN_SIZE children[BTREE_NODE + 2];
+            memcpy(keys, node->keys, sizeof(GEN_KEY) * p);
+            memcpy(keys + p + 1, node->keys + p, sizeof(GEN_KEY) * (BTREE_NODE - p));
+            keys[p] = splitKey;
+            memcpy(children, node->children, sizeof(GEN_SIZE) * (p + 1));
+            memcpy(children + p + 2, node->children + p + 1, sizeof(GEN_SIZE) * (BTREE_NODE - p));
+            children[p + 1] = splitIndex;
+            splitIndex = GEN_NAME_(newInner)(tree);
+            node = tree->inners + path[h].index;
+            GEN_NAME_(inner)* split = tree->inners + splitIndex;
+            GEN_SIZE middle = (BTREE_NODE + 1) / 2;
+            node->length = middle;
+            memcpy(node->keys, keys, sizeof(GEN_KEY) * middle);
+            memcpy(node->children, children, sizeof(GEN_SIZE) * (middle + 1));
+            split->length = BTREE_NODE - middle;
+            memcpy(split->keys, keys + middle + 1, sizeof(GEN_KEY) * split->length);
+            memcpy(split->children, children + middle + 1, sizeof(GEN_SIZE) * (split->length + 1));
+            splitKey = keys[middle];
+        }
+
+        // New root
+        if (h > tree->height) {
+            GEN_SIZE rootIndex = GEN_NAME_(newInner)(tree);
+            GEN_NAME_(inner)* root = tree->inners + rootIndex;
+            root->length = 1;
+            root->keys[0] = splitKey;
+            root->children[0] = tree->root;
+            root->children[1] = splitIndex;
+            tree->root = rootIndex;
+            tree->height++;
+        }
+    }
+
+#ifdef GEN_NO_VALUE
+    return true;
+#else
+    if (added) *added = true;
+    return value;
+#endif
+}
+
+
+// Fix a leaf with too few items by moving an item from a sibling or by merging it with a sibling
+static void GEN_NAME_(fixLeaf)(GEN_ALGO* tree, GEN_NAME_(inner)* parent, GEN_SIZE pos) {
+    GEN_NAME_(leaf)* leaf = tree->leaves + parent->children[pos];
+    if (pos > 0) {
+        GEN_NAME_(leaf)* left = tree->leaves + parent->children[pos - 1];
+        if (left->length > BTREE_LEAF_MIN) {
+            memmove(leaf->items + 1, leaf->items, sizeof(GEN_KV_TYPE) * leaf->length);
+            leaf->items[0] = left->items[--left->length];
+            leaf->length++;
+            parent->keys[pos - 1] = GEN_KV_KEY(leaf->items[0]);
+            return;
+        }
+    }
+    if (pos < parent->length) {
+        GEN_NAME_(leaf)* right = tree->leaves + parent->children[pos + 1];
+        if (right->length > BTREE_LEAF_MIN) {
+            leaf->items[leaf->length++] = right->items[0];
+            memmove(right->items, right->items + 1, sizeof(GEN_KV_TYPE) * --right->length);
+            parent->keys[pos] = GEN_KV_KEY(right->items[0]);
+            return;
+        }
+    }
+
+    // Merge with the left or right sibling
+    if (pos > 0) pos--;
+    GEN_SIZE rightIndex = parent->children[pos + 1];
+    GEN_NAME_(leaf)* left = tree->leaves + parent->children[pos];
+    GEN_NAME_(leaf)* right = tree->leaves + rightIndex;
+    memcpy(left->items + left->length, right->items, sizeof(GEN_KV_TYPE) * right->length);
+    left->length += right->length;
+    left->next = right->next;
+    right->next = tree->reusableLeaf;
+    tree->reusableLeaf = rightIndex;
+    parent->length--;
+    memmove(parent->keys + pos, parent->keys + pos + 1, sizeof(GEN_KEY) * (parent->length - pos));
+    memmove(parent->children + pos + 1, parent->children + pos + 2, sizeof(GEN_SIZE) * (parent->length - pos));
+}
+
+
+// Fix an inner node with too few keys by moving a key from a sibling or by merging it with a sibling
+static void GEN_NAME_(fixInner)(GEN_ALGO* tree, GEN_NAME_(inner)* parent, GEN_SIZE pos) {
+    GEN_NAME_(inner)* node = tree->inners + parent->children[pos];
+    if (pos > 0) {
+        GEN_NAME_(inner)* left = tree->inners + parent->children[pos - 1];
+        if (left->length > BTREE_INNER_MIN) {
+            memmove(node->keys + 1, node->keys, sizeof(GEN_KEY) * node->length);
+            memmove(node->children + 1, node->children, sizeof(GEN_SIZE) * (node->length + 1));
+            node->keys[0] = parent->keys[pos - 1];
+            node->children[0] = left->children[left->length];
+            node->length++;
+            parent->keys[pos - 1] = left->keys[--left->length];
+            return;
+        }
+    }
+    if (pos < parent->length) {
+        GEN_NAME_(inner)* right = tree->inners + parent->children[pos + 1];
+        if (right->length > BTREE_INNER_MIN) {
+            node->keys[node->length] = parent->keys[pos];
+            node->children[++node->length] = right->children[0];
+            parent->keys[pos] = right->keys[0];
+            right->length--;
+            memmove(right->keys, right->keys + 1, sizeof(GEN_KEY) * right->length);
+            memmove(right->children, right->children + 1, sizeof(GEN_SIZE) * (right->length + 1));
+            return;
+        }
+    }
+
+    // Merge with the left or right sibling, the key between them moves down
+    if (pos > 0) pos--;
+    GEN_SIZE rightIndex = parent->children[pos + 1];
+    GEN_NAME_(inner)* left = tree->inners + parent->children[pos];
+    GEN_NAME_(inner)* right = tree->inners + rightIndex;
+    left->keys[left->length] = parent->keys[pos];
+    memcpy(left->keys + left->length + 1, right->keys, sizeof(GEN_KEY) * right->length);
+    memcpy(left->children + left->length + 1, right->children, sizeof(GEN_SIZE) * (right->length + 1));
+    left->length += 1 + right->length;
+    right->children[0] = tree->reusableInner;
+    tree->reusableInner = rightIndex;
+    parent->length--;
+    memmove(parent->keys + pos, parent->keys + pos + 1, sizeof(GEN_KEY) * (parent->length - pos));
+    memmove(parent->children + pos + 1, parent->children + pos + 2, sizeof(GEN_SIZE) * (parent->length - pos));
+}
+
+
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* tree, GEN_KEY key) {
+    GEN_NAME_(path) path[BTREE_STACK];
+
+    // Find item
+    GEN_SIZE index = tree->root;
+    for (int h = tree->height; h > 0; h--) {
+        GEN_NAME_(inner)* node = tree->inners + index;
+        GEN_SIZE pos = GEN_NAME_(innerPos)(node, key);
+        path[h].index = index;
+        path[h].pos = pos;
+        index = node->children[pos];
+    }
+    GEN_NAME_(leaf)* leaf = tree->leaves + index;
+    GEN_SIZE pos = GEN_NAME_(leafPos)(leaf, key);
+    if (pos >= leaf->length || GEN_COMPARE(key, GEN_KV_KEY(leaf->items[pos])) != 0) return 0;
+
+    // Remove item
+#ifndef GEN_NO_VALUE
+    tree->removed = leaf->items[pos].value;
+#endif
+    leaf->length--;
+    memmove(leaf->items + pos, leaf->items + pos + 1, sizeof(GEN_KV_TYPE) * (leaf->length - pos));
+    tree->length--;
+
+    // Maintain minimum number of items in each node
+    bool fix = leaf->length < BTREE_LEAF_MIN;
+    for (int h = 1; h <= tree->height && fix; h++) {
+        GEN_NAME_(inner)* parent = tree->inners + path[h].index;
+        if (h == 1) GEN_NAME_(fixLeaf)(tree, parent, path[h].pos);
+        else GEN_NAME_(fixInner)(tree, parent, path[h].pos);
+        fix = parent->length < BTREE_INNER_MIN;
+    }
+    if (tree->height > 0 && tree->inners[tree->root].length == 0) { // Remove empty root
+        GEN_SIZE rootIndex = tree->root;
+        tree->root = tree->inners[rootIndex].children[0];
+        tree->inners[rootIndex].children[0] = tree->reusableInner;
+        tree->reusableInner = rootIndex;
+        tree->height--;
+    }
+
+    return GEN_IF_VALUE(&tree->removed, true);
+}
+
+
+GEN_KV_TYPE* GEN_NAME(floor)(GEN_ALGO* tree, GEN_KEY key) {
+    // Find leaf, and the last sub-tree on its left in case the leaf does not contain the floor
+    GEN_SIZE index = tree->root;
+    GEN_SIZE leftIndex = GEN_NONE;
+    int leftHeight = 0;
+    for (int h = tree->height; h > 0; h--) {
+        GEN_NAME_(inner)* node = tree->inners + index;
+        GEN_SIZE pos = GEN_NAME_(innerPos)(node, key);
+        if (pos > 0) {
+            leftIndex = node->children[pos - 1];
+            leftHeight = h - 1;
+        }
+        index = node->children[pos];
+    }
+    GEN_NAME_(leaf)* leaf = tree->leaves + index;
+    GEN_SIZE pos = 0;
+    for (GEN_SIZE i = 0; i < leaf->length; i++) pos += GEN_COMPARE(key, GEN_KV_KEY(leaf->items[i])) >= 0;
+    if (pos > 0) return &leaf->items[pos - 1];
+
+    // Last item of the sub-tree on the left
+    if (leftIndex == GEN_NONE) return NULL;
+    for (; leftHeight > 0; leftHeight--) {
+        GEN_NAME_(inner)* node = tree->inners + leftIndex;
+        leftIndex = node->children[node->length];
+    }
+    leaf = tree->leaves + leftIndex;
+    return &leaf->items[leaf->length - 1];
+}
+
+
+GEN_KV_TYPE* GEN_NAME(ceil)(GEN_ALGO* tree, GEN_KEY key) {
+    GEN_NAME_(leaf)* leaf = tree->leaves + GEN_NAME_(findLeaf)(tree, key);
+    GEN_SIZE pos = GEN_NAME_(leafPos)(leaf, key);
+    if (pos < leaf->length) return &leaf->items[pos];
+    if (leaf->next == GEN_NONE) return NULL;
+    return &tree->leaves[leaf->next].items[0];
+}
+
+
+#endif
+
+// Undef parameters for later use
+#undef BTREE_NODE
+#undef BTREE_LEAF_MIN
+#undef BTREE_INNER_MIN
+#undef BTREE_STACK
+
+#include "generic_end.h"
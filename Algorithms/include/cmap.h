@@ -0,0 +1,382 @@
+#define GEN_PREFIX cmap
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "throw.h"
+
+// Concurrent hash map made of independently locked maps
+// A map with the same parameters and the same suffix must be included before the concurrent map
+// Each shard is only protected by a pthread rwlock, reads have no lock-free path (such as a seqlock): a read still writes
+// the lock of its shard, so threads reading the same shards contend on their cache lines, and adds to a shard are serialized.
+// Operations on different shards, including growing a shard, do not wait for each other, but the short operations
+// of the benchmark in test_cmap.c spend most of their time locking, so sharding is not expected to scale them linearly
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys, should be the same as the one of the map (default: the key)
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+
+// Map type and functions
+#define CMAP_MAP GEN_ALGO_OF(map)
+#define CMAP_MAP_NAME(name) GEN_NAME_OF(map, name)
+#ifdef GEN_NO_VALUE
+#define CMAP_KV_TYPE GEN_KEY
+#else
+#define CMAP_KV_TYPE GEN_NAME_OF(map, kv)
+#endif
+
+// Shard of a key, selected by the higher bits of the mixed hash so that it does not depend on the bucket in the shard
+#define CMAP_SHARD(cmap, key) ((cmap)->shards + (((uint32_t)MAP_HASH(key) * 0x9E3779B9u) >> 16 & (cmap)->mask))
+
+
+/**
+ * @brief Shard of a concurrent map, aligned to a cache line to avoid false sharing of the locks
+ * @param lock Lock of the shard
+ * @param map Items of the shard
+**/
+typedef struct {
+    _Alignas(64) pthread_rwlock_t lock;
+    CMAP_MAP map;
+} GEN_NAME_(shard);
+
+
+/**
+ * @brief Shard locked by [ref] or [refOrEmpty], to unlock with [release]
+**/
+typedef GEN_NAME_(shard)* GEN_NAME(handle);
+
+
+/**
+ * @brief Concurrent resizable hash map
+ * @param shards The shards, each one grows independently of the others
+ * @param mask Number of shards - 1
+**/
+typedef struct {
+    GEN_NAME_(shard)* shards;
+    GEN_SIZE mask;
+} GEN_ALGO;
+
+
+/**
+ * @brief Initialize a concurrent map
+ * @param cmap The concurrent map
+ * @param shards Number of shards (must be a power of 2, at most 65536)
+ * @param capacity Initial capacity of each shard
+**/
+inline void GEN_NAME(init)(GEN_ALGO* cmap, GEN_SIZE shards, GEN_SIZE capacity) {
+    cmap->shards = THROW_PN(aligned_alloc(64, sizeof(GEN_NAME_(shard)) * shards), cmap->shards);
+    cmap->mask = shards - 1;
+    for (GEN_SIZE i = 0; i < shards; i++) {
+        THROW_R(pthread_rwlock_init(&cmap->shards[i].lock, NULL));
+        CMAP_MAP_NAME(init)(&cmap->shards[i].map, capacity);
+    }
+}
+
+
+/**
+ * @brief Create a concurrent map
+ * @param shards Number of shards (must be a power of 2, at most 65536)
+ * @param capacity Initial capacity of each shard
+ * @return The concurrent map
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE shards, GEN_SIZE capacity) {
+    GEN_ALGO cmap;
+    GEN_NAME(init)(&cmap, shards, capacity);
+    return cmap;
+}
+
+
+/**
+ * @brief Free a concurrent map (must not be used by other threads)
+ * @param cmap The concurrent map
+**/
+inline void GEN_NAME(free)(GEN_ALGO* cmap) {
+    for (GEN_SIZE i = 0; i <= cmap->mask; i++) {
+        pthread_rwlock_destroy(&cmap->shards[i].lock);
+        CMAP_MAP_NAME(free)(&cmap->shards[i].map);
+    }
+    free(cmap->shards);
+}
+
+
+/**
+ * @brief Release the shard locked by [ref] or [refOrEmpty]
+ * @param handle The locked shard
+**/
+inline void GEN_NAME(release)(GEN_NAME(handle) handle) {
+    THROW_R(pthread_rwlock_unlock(&handle->lock));
+}
+
+
+#ifndef GEN_NO_VALUE
+
+
+/**
+ * @brief Get an item in a concurrent map, the shard of the key stays locked for reading until [release] is called
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @param handle Set to the locked shard, to pass to [release]
+ * @return Pointer to the value of the item (usable until [release]), NULL if not found
+**/
+inline GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* cmap, GEN_KEY key, GEN_NAME(handle)* handle) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_rdlock(&shard->lock));
+    *handle = shard;
+    return CMAP_MAP_NAME(ref)(&shard->map, key);
+}
+
+
+/**
+ * @brief Get an item in a concurrent map or create it if not found, the shard of the key stays locked for writing until [release] is called
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @param added Whether a new item was added (NULL to ignore)
+ * @param handle Set to the locked shard, to pass to [release]
+ * @return Pointer to the value of the item (usable until [release])
+**/
+inline GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* cmap, GEN_KEY key, bool* added, GEN_NAME(handle)* handle) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    *handle = shard;
+    return CMAP_MAP_NAME(refOrEmpty)(&shard->map, key, added);
+}
+
+
+/**
+ * @brief Get the value associated with a key in a concurrent map if found or a default value otherwise
+ * @param cmap The concurrent map
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_rdlock(&shard->lock));
+    GEN_TYPE* pValue = CMAP_MAP_NAME(ref)(&shard->map, key);
+    if (pValue != NULL) value = *pValue;
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return value;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a concurrent map if found (undefined otherwise)
+ * @param cmap The concurrent map
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* cmap, GEN_KEY key) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_rdlock(&shard->lock));
+    GEN_TYPE value = *CMAP_MAP_NAME(ref)(&shard->map, key);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return value;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a concurrent map if found or create a new item with that value otherwise
+ * @param cmap The concurrent map
+ * @param key The key
+ * @param value New value
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(setOrAdd)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(handle) handle;
+    *GEN_NAME(refOrEmpty)(cmap, key, &added, &handle) = value;
+    GEN_NAME(release)(handle);
+    return added;
+}
+
+
+/**
+ * @brief Add an item in a concurrent map if it does not already exist
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(handle) handle;
+    GEN_TYPE* pValue = GEN_NAME(refOrEmpty)(cmap, key, &added, &handle);
+    if (added) *pValue = value;
+    GEN_NAME(release)(handle);
+    return added;
+}
+
+
+/**
+ * @brief Add an item in a concurrent map (undefined if it already exists)
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @param value Value of the item
+**/
+inline void GEN_NAME(add)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    CMAP_MAP_NAME(add)(&shard->map, key, value);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+}
+
+
+/**
+ * @brief Remove an item in a concurrent map if found
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @param value Value of the removed item (NULL to ignore)
+ * @return Whether the item was found
+**/
+inline bool GEN_NAME(remove)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE* value) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    GEN_TYPE* pValue = CMAP_MAP_NAME(remove)(&shard->map, key);
+    if (pValue != NULL && value != NULL) *value = *pValue;
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return pValue != NULL;
+}
+
+
+#else
+
+
+/**
+ * @brief Add an item in a concurrent map if it does not already exist
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* cmap, GEN_KEY key) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    bool added = CMAP_MAP_NAME(tryAdd)(&shard->map, key);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return added;
+}
+
+
+/**
+ * @brief Add an item in a concurrent map (undefined if it already exists)
+ * @param cmap The concurrent map
+ * @param key Key of the item
+**/
+inline void GEN_NAME(add)(GEN_ALGO* cmap, GEN_KEY key) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    CMAP_MAP_NAME(add)(&shard->map, key);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+}
+
+
+/**
+ * @brief Remove an item in a concurrent map if found
+ * @param cmap The concurrent map
+ * @param key Key of the item
+ * @return Whether the item was found
+**/
+inline bool GEN_NAME(remove)(GEN_ALGO* cmap, GEN_KEY key) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_wrlock(&shard->lock));
+    bool removed = CMAP_MAP_NAME(remove)(&shard->map, key);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return removed;
+}
+
+
+#endif
+
+
+/**
+ * @brief Check whether a concurrent map contains a key
+ * @param cmap The concurrent map
+ * @param key The key
+ * @return Whether the key was found
+**/
+inline bool GEN_NAME(contains)(GEN_ALGO* cmap, GEN_KEY key) {
+    GEN_NAME_(shard)* shard = CMAP_SHARD(cmap, key);
+    THROW_R(pthread_rwlock_rdlock(&shard->lock));
+    bool found = CMAP_MAP_NAME(contains)(&shard->map, key);
+    THROW_R(pthread_rwlock_unlock(&shard->lock));
+    return found;
+}
+
+
+/**
+ * @brief Get the number of items in a concurrent map
+ * @param cmap The concurrent map
+ * @return Number of items
+**/
+inline GEN_SIZE GEN_NAME(length)(GEN_ALGO* cmap) {
+    GEN_SIZE length = 0;
+    for (GEN_SIZE i = 0; i <= cmap->mask; i++) {
+        THROW_R(pthread_rwlock_rdlock(&cmap->shards[i].lock));
+        length += cmap->shards[i].map.length;
+        THROW_R(pthread_rwlock_unlock(&cmap->shards[i].lock));
+    }
+    return length;
+}
+
+
+/**
+ * @brief Call a function on every item of a concurrent map, each shard is locked for reading while its items are visited
+ * @param cmap The concurrent map
+ * @param func The function
+ * @param arg Argument passed to the function
+**/
+void GEN_NAME(forEach)(GEN_ALGO* cmap, void (*func)(CMAP_KV_TYPE* item, void* arg), void* arg);
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* cmap, GEN_SIZE shards, GEN_SIZE capacity);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE shards, GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* cmap);
+void GEN_NAME(release)(GEN_NAME(handle) handle);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* cmap, GEN_KEY key, GEN_NAME(handle)* handle);
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* cmap, GEN_KEY key, bool* added, GEN_NAME(handle)* handle);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* cmap, GEN_KEY key);
+bool GEN_NAME(setOrAdd)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(tryAdd)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(add)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(remove)(GEN_ALGO* cmap, GEN_KEY key, GEN_TYPE* value);
+#else
+bool GEN_NAME(tryAdd)(GEN_ALGO* cmap, GEN_KEY key);
+void GEN_NAME(add)(GEN_ALGO* cmap, GEN_KEY key);
+bool GEN_NAME(remove)(GEN_ALGO* cmap, GEN_KEY key);
+#endif
+bool GEN_NAME(contains)(GEN_ALGO* cmap, GEN_KEY key);
+GEN_SIZE GEN_NAME(length)(GEN_ALGO* cmap);
+
+
+void GEN_NAME(forEach)(GEN_ALGO* cmap, void (*func)(CMAP_KV_TYPE* item, void* arg), void* arg) {
+    for (GEN_SIZE i = 0; i <= cmap->mask; i++) {
+        GEN_NAME_(shard)* shard = cmap->shards + i;
+        THROW_R(pthread_rwlock_rdlock(&shard->lock));
+        GEN_NAME_OF(map, iter) iter = CMAP_MAP_NAME(iterStart)();
+        CMAP_KV_TYPE* item;
+        while ((item = CMAP_MAP_NAME(iterNext)(&shard->map, &iter))) func(item, arg);
+        THROW_R(pthread_rwlock_unlock(&shard->lock));
+    }
+}
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef CMAP_MAP
+#undef CMAP_MAP_NAME
+#undef CMAP_KV_TYPE
+#undef CMAP_SHARD
+
+#include "generic_end.h"
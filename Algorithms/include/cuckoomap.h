@@ -0,0 +1,548 @@
+#ifndef GEN_PREFIX
+#define GEN_PREFIX cuckoomap
+#endif
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "throw.h"
+
+// Hash map using bucketized cuckoo hashing : each key can only be in one of two buckets of a few slots,
+// so a search reads at most two buckets (two cache lines for small items)
+// An item added to two full buckets moves other items to their other bucket, using a breadth-first search for the shortest path
+// Defining GEN_PREFIX as map before including this file gives a drop-in replacement for the functions of map.h
+// that are also in this file
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys (default: the key), mixed before use
+// MAP_MAX_LOAD : Maximum number of items per slot before growing (default: 0.9)
+// CUCKOOMAP_WAYS : Number of slots per bucket (default: 4), a bucket with its tags must fit in one cache line
+//     (checked at compile time), e.g. 4 ways of int keys and int values, or 8 ways of int keys without values
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+
+#ifndef MAP_MAX_LOAD
+#define MAP_MAX_LOAD 0.9
+#endif
+
+#ifndef CUCKOOMAP_WAYS
+#define CUCKOOMAP_WAYS 4
+#endif
+
+
+#ifndef CUCKOOMAP_H
+#define CUCKOOMAP_H
+
+// Size of a cache line, buckets are aligned on it
+#define CUCKOOMAP_LINE 64
+
+// Maximum number of buckets visited when searching for a path to an empty slot, the map grows if none is found
+#define CUCKOOMAP_SEARCH 256
+
+// Other bucket of an item from its bucket and its tag, on 64 bits for maps of more than 2^32 buckets
+static inline uint64_t _cuckoomap_other(uint64_t bucket, uint8_t tag, uint64_t mask) {
+    return (bucket ^ (tag * 0xc6a4a7935bd1e995ull)) & mask;
+}
+
+#endif
+
+// Number of items that fit in a number of buckets
+#define CUCKOOMAP_CAPACITY(buckets) ((GEN_SIZE)((double)(buckets) * CUCKOOMAP_WAYS * (MAP_MAX_LOAD)))
+
+// Maximum number of buckets, so slot indexes use at most half of the size range and -1 is never a slot
+#define CUCKOOMAP_MAX_BUCKETS ((GEN_SIZE)(((GEN_SIZE_MAX >> 1) + 1) / CUCKOOMAP_WAYS))
+
+
+/**
+ * @brief Bucket of a map
+ * @param tags Tag of the key of each slot (bits of its hash, never 0), 0 if the slot is empty
+ * @param items Items of each slot
+**/
+typedef struct {
+    _Alignas(CUCKOOMAP_LINE) uint8_t tags[CUCKOOMAP_WAYS];
+    GEN_KV_TYPE items[CUCKOOMAP_WAYS];
+} GEN_NAME(bucket);
+
+// A search reads at most two buckets, so at most two cache lines
+_Static_assert(sizeof(GEN_NAME(bucket)) == CUCKOOMAP_LINE, "A bucket must fit in a cache line, use fewer ways or smaller items");
+
+
+/**
+ * @brief Resizable hash map using bucketized cuckoo hashing
+ * @param buckets Buckets of slots
+ * @param length Number of items in the map
+ * @param mask Number of buckets - 1
+ * @param capacity Number of items that can be added before growing
+**/
+typedef struct {
+    GEN_NAME(bucket)* buckets;
+    GEN_SIZE length;
+    GEN_SIZE mask;
+    GEN_SIZE capacity;
+} GEN_ALGO;
+
+
+/**
+ * @brief Map iterator
+ * @param index Index of the slot (bucket * CUCKOOMAP_WAYS + slot in the bucket)
+**/
+typedef struct {
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Initialize a map
+ * @param map The map
+ * @param capacity Initial capacity
+**/
+inline void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity) {
+    GEN_SIZE buckets = 2;
+    while (CUCKOOMAP_CAPACITY(buckets) < capacity) {
+        if (buckets > CUCKOOMAP_MAX_BUCKETS >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)CUCKOOMAP_CAPACITY(buckets));
+        buckets <<= 1;
+    }
+    map->buckets = THROW_PN(aligned_alloc(CUCKOOMAP_LINE, sizeof(GEN_NAME(bucket)) * buckets), map->buckets);
+    memset(map->buckets, 0, sizeof(GEN_NAME(bucket)) * buckets);
+    map->length = 0;
+    map->mask = buckets - 1;
+    map->capacity = CUCKOOMAP_CAPACITY(buckets);
+}
+
+
+/**
+ * @brief Create a map
+ * @param capacity Initial capacity
+ * @return The map
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
+    GEN_ALGO map;
+    GEN_NAME(init)(&map, capacity);
+    return map;
+}
+
+
+/**
+ * @brief Free a map
+ * @param map The map
+**/
+inline void GEN_NAME(free)(GEN_ALGO* map) {
+    free(map->buckets);
+}
+
+
+#ifndef GEN_NO_VALUE
+
+
+/**
+ * @brief Get an item in a map
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added item), NULL if not found
+**/
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Get an item in a map or create it if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added);
+
+
+/**
+ * @brief Get an item in a map or create it with a default value if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param value Default value
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+inline GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added) {
+    bool _added;
+    GEN_TYPE* pValue = GEN_NAME(refOrEmpty)(map, key, &_added);
+    if (_added) *pValue = value;
+    if (added) *added = _added;
+    return pValue;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found (undefined otherwise)
+ * @param map The map
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key) {
+    return *GEN_NAME(ref)(map, key);
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found or a default value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(map, key);
+    return pValue == NULL ? value : *pValue;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map (undefined if not found)
+ * @param map The map
+ * @param key The key
+ * @param value New value
+**/
+inline void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME(ref)(map, key) = value;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map if found or create a new item with that value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value New value
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    *GEN_NAME(refOrEmpty)(map, key, &added) = value;
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Check whether a map contains a key
+ * @param map The map
+ * @param key The key
+ * @return Whether the key was found
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME(ref)(map, key) != NULL;
+}
+#endif
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Add an item with no value in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item
+**/
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key);
+#endif
+
+
+/**
+ * @brief Add an item in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+**/
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME_(addEmpty)(map, key) = value;
+}
+#endif
+
+
+/**
+ * @brief Add an item in a map if it does not already exist
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(refOrDefault)(map, key, value, &added);
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Remove an item in a map if found
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the removed item (usable until next added item)
+**/
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Start iterating on a map
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterStart)(void) {
+    return (GEN_NAME(iter)) { .index = GEN_NONE };
+}
+
+
+/**
+ * @brief Get the next item while iterating on a map
+ * @param map The map
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
+    while ((GEN_SIZE)(iter->index + 1) < (map->mask + 1) * CUCKOOMAP_WAYS) {
+        iter->index++;
+        GEN_NAME(bucket)* bucket = map->buckets + iter->index / CUCKOOMAP_WAYS;
+        if (bucket->tags[iter->index % CUCKOOMAP_WAYS] != 0) return bucket->items + iter->index % CUCKOOMAP_WAYS;
+    }
+    return NULL;
+}
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* map);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#endif
+GEN_NAME(iter) GEN_NAME(iterStart)();
+GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+
+
+// Item in a slot
+#define CUCKOOMAP_ITEM(map, index) ((map)->buckets[(index) / CUCKOOMAP_WAYS].items[(index) % CUCKOOMAP_WAYS])
+
+
+// Tag and first bucket of a key
+static inline uint8_t GEN_NAME_(hash)(GEN_ALGO* map, GEN_KEY key, GEN_SIZE* bucket) {
+    uint64_t hash = (uint64_t)MAP_HASH(key) * 0x9E3779B97F4A7C15ull;
+    *bucket = (hash ^ (hash >> 32)) & map->mask;
+    return (hash >> 57) + 1;
+}
+
+
+// Index of the slot of a key in a bucket if found, -1 otherwise
+static inline GEN_SIZE GEN_NAME_(searchBucket)(GEN_ALGO* map, GEN_SIZE bucket, GEN_KEY key, uint8_t tag) {
+    GEN_NAME(bucket)* b = map->buckets + bucket;
+    for (int i = 0; i < CUCKOOMAP_WAYS; i++) {
+        if (b->tags[i] == tag && GEN_EQUALS(key, GEN_KV_KEY(b->items[i]))) return bucket * CUCKOOMAP_WAYS + i;
+    }
+    return GEN_NONE;
+}
+
+
+// Index of the slot of a key if found, -1 otherwise
+static GEN_SIZE GEN_NAME_(search)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE bucket;
+    uint8_t tag = GEN_NAME_(hash)(map, key, &bucket);
+    GEN_SIZE index = GEN_NAME_(searchBucket)(map, bucket, key, tag);
+    if (index != GEN_NONE) return index;
+    return GEN_NAME_(searchBucket)(map, _cuckoomap_other(bucket, tag, map->mask), key, tag);
+}
+
+
+// Index of an empty slot in a bucket, -1 if the bucket is full
+static inline int GEN_NAME_(emptySlot)(GEN_ALGO* map, GEN_SIZE bucket) {
+    for (int i = 0; i < CUCKOOMAP_WAYS; i++) {
+        if (map->buckets[bucket].tags[i] == 0) return i;
+    }
+    return -1;
+}
+
+
+// Bucket visited while searching for an empty slot
+typedef struct {
+    GEN_SIZE bucket;
+    int parent; // Index of the bucket the item was moved from in the search, -1 for the buckets of the added key
+    int slot; // Slot of the item in the parent bucket
+} GEN_NAME_(step);
+
+
+// Place a key that is not in the map in one of its buckets, moving other items if needed
+// Return the index of its slot, -1 if no empty slot was found
+static GEN_SIZE GEN_NAME_(place)(GEN_ALGO* map, GEN_KEY key, uint8_t tag, GEN_SIZE bucket) {
+    GEN_NAME_(step) steps[CUCKOOMAP_SEARCH];
+    steps[0] = (GEN_NAME_(step)) { bucket, -1, 0 };
+    steps[1] = (GEN_NAME_(step)) { _cuckoomap_other(bucket, tag, map->mask), -1, 0 };
+    int length = steps[1].bucket == bucket ? 1 : 2;
+    for (int i = 0; i < length; i++) {
+        GEN_SIZE current = steps[i].bucket;
+        int slot = GEN_NAME_(emptySlot)(map, current);
+        if (slot == -1) {
+            // Visit the other buckets of the items, unless they are already in the path
+            for (int j = 0; j < CUCKOOMAP_WAYS && length < CUCKOOMAP_SEARCH; j++) {
+                GEN_SIZE other = _cuckoomap_other(current, map->buckets[current].tags[j], map->mask);
+                bool inPath = false;
+                for (int k = i; k != -1 && !inPath; k = steps[k].parent) inPath = steps[k].bucket == other;
+                if (!inPath) steps[length++] = (GEN_NAME_(step)) { other, i, j };
+            }
+            continue;
+        }
+        // Move the items along the path, each one to the slot freed by the next one
+        int k = i;
+        while (steps[k].parent != -1) {
+            GEN_NAME(bucket)* to = map->buckets + steps[k].bucket;
+            GEN_NAME(bucket)* from = map->buckets + steps[steps[k].parent].bucket;
+            to->tags[slot] = from->tags[steps[k].slot];
+            to->items[slot] = from->items[steps[k].slot];
+            slot = steps[k].slot;
+            k = steps[k].parent;
+        }
+        GEN_NAME(bucket)* b = map->buckets + steps[k].bucket;
+        b->tags[slot] = tag;
+        GEN_KV_KEY(b->items[slot]) = key;
+        return steps[k].bucket * CUCKOOMAP_WAYS + slot;
+    }
+    return GEN_NONE;
+}
+
+
+// Rebuild the map with at least twice as many buckets
+static void GEN_NAME_(grow)(GEN_ALGO* map) {
+    GEN_NAME(bucket)* oldBuckets = map->buckets;
+    GEN_SIZE oldCount = map->mask + 1;
+    GEN_SIZE count = oldCount;
+    bool placed = false;
+    while (!placed) {
+        // Grow again if items of the old buckets can not be placed in the new ones
+        if (count > CUCKOOMAP_MAX_BUCKETS >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)map->length);
+        count <<= 1;
+        map->buckets = THROW_PN(aligned_alloc(CUCKOOMAP_LINE, sizeof(GEN_NAME(bucket)) * count), map->buckets);
+        memset(map->buckets, 0, sizeof(GEN_NAME(bucket)) * count);
+        map->mask = count - 1;
+        placed = true;
+        for (GEN_SIZE i = 0; i < oldCount && placed; i++) {
+            for (int j = 0; j < CUCKOOMAP_WAYS && placed; j++) {
+                if (oldBuckets[i].tags[j] == 0) continue;
+                GEN_SIZE bucket;
+                uint8_t tag = GEN_NAME_(hash)(map, GEN_KV_KEY(oldBuckets[i].items[j]), &bucket);
+                GEN_SIZE index = GEN_NAME_(place)(map, GEN_KV_KEY(oldBuckets[i].items[j]), tag, bucket);
+                if (index == GEN_NONE) placed = false;
+                else CUCKOOMAP_ITEM(map, index) = oldBuckets[i].items[j];
+            }
+        }
+        if (!placed) free(map->buckets);
+    }
+    map->capacity = CUCKOOMAP_CAPACITY(count);
+    free(oldBuckets);
+}
+
+
+// Add an item for a key that is not in the map
+static GEN_KV_TYPE* GEN_NAME_(addItem)(GEN_ALGO* map, GEN_KEY key) {
+    if (map->length >= map->capacity) GEN_NAME_(grow)(map);
+    map->length++;
+    GEN_SIZE bucket;
+    uint8_t tag = GEN_NAME_(hash)(map, key, &bucket);
+    GEN_SIZE index;
+    while ((index = GEN_NAME_(place)(map, key, tag, bucket)) == GEN_NONE) {
+        GEN_NAME_(grow)(map);
+        GEN_NAME_(hash)(map, key, &bucket);
+    }
+    return &CUCKOOMAP_ITEM(map, index);
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME_(search)(map, key) != GEN_NONE;
+}
+#else
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    return index == GEN_NONE ? NULL : &CUCKOOMAP_ITEM(map, index).value;
+}
+#endif
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added) {
+#endif
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    if (index != GEN_NONE) {
+#ifdef GEN_NO_VALUE
+        return false;
+#else
+        if (added) *added = false;
+        return &CUCKOOMAP_ITEM(map, index).value;
+#endif
+    }
+#ifdef GEN_NO_VALUE
+    GEN_NAME_(addItem)(map, key);
+    return true;
+#else
+    if (added) *added = true;
+    return &GEN_NAME_(addItem)(map, key)->value;
+#endif
+}
+
+
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_NAME_(addItem)(map, key);
+}
+#else
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key) {
+    return &GEN_NAME_(addItem)(map, key)->value;
+}
+#endif
+
+
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    if (index == GEN_NONE) return 0;
+    map->length--;
+    // The item stays in its slot until another item is placed there
+    map->buckets[index / CUCKOOMAP_WAYS].tags[index % CUCKOOMAP_WAYS] = 0;
+#ifdef GEN_NO_VALUE
+    return true;
+#else
+    return &CUCKOOMAP_ITEM(map, index).value;
+#endif
+}
+
+
+#undef CUCKOOMAP_ITEM
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef MAP_MAX_LOAD
+#undef CUCKOOMAP_WAYS
+#undef CUCKOOMAP_CAPACITY
+#undef CUCKOOMAP_MAX_BUCKETS
+
+#include "generic_end.h"
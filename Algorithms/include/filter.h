@@ -0,0 +1,386 @@
+#define GEN_PREFIX filter
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "throw.h"
+#include "hash.h"
+
+// Approximate set of keys that can report keys that were not added (false positives) but never misses an added key
+// Blocked Bloom filter by default : each key sets 8 bits in a block of 32 bytes, keys cannot be removed
+// Cuckoo filter if [FILTER_CUCKOO] : each key is a 16-bit fingerprint in one of 2 buckets of 4 fingerprints, keys can be removed
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys (default: the key), mixed before use
+// FILTER_CUCKOO : Whether to use a cuckoo filter instead of a blocked Bloom filter (default: false)
+// FILTER_BITS : Number of bits per key of a Bloom filter, the false positive rate is about 2% with 8 bits, 0.2% with 16 bits (default: 16)
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+#ifndef FILTER_BITS
+#define FILTER_BITS 16
+#endif
+
+// Result of adding a key (only cuckoo filters can be full)
+#ifdef FILTER_CUCKOO
+#define FILTER_ADD_TYPE bool
+#else
+#define FILTER_ADD_TYPE void
+#endif
+
+
+#ifndef FILTER_H
+#define FILTER_H
+
+// Number of 32-bit words in a block of a Bloom filter (one bit is set in each word)
+#define FILTER_BLOCK 8
+
+// Number of fingerprints in a bucket of a cuckoo filter
+#define FILTER_SLOTS 4
+
+// Maximum number of fingerprints moved to insert a fingerprint in a cuckoo filter
+#define FILTER_KICKS 500
+
+// Bits of each word of a Bloom filter block set by a hash
+static inline void _filter_blockMask(uint32_t hash, uint32_t* mask) {
+    static const uint32_t salts[FILTER_BLOCK] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+    };
+    for (int i = 0; i < FILTER_BLOCK; i++) mask[i] = 1u << ((hash * salts[i]) >> 27);
+}
+
+// Whether a 64-bit word made of 4 fingerprints contains a fingerprint
+static inline bool _filter_hasFingerprint(uint64_t bucket, uint16_t fingerprint) {
+    uint64_t x = bucket ^ (fingerprint * 0x0001000100010001ull);
+    return ((x - 0x0001000100010001ull) & ~x & 0x8000800080008000ull) != 0;
+}
+
+// Fingerprint of a hash for a cuckoo filter (never 0, which marks empty slots)
+static inline uint16_t _filter_fingerprint(uint64_t hash) {
+    uint16_t fingerprint = (uint16_t)hash;
+    return fingerprint == 0 ? 1 : fingerprint;
+}
+
+// Alternate bucket of a fingerprint in a cuckoo filter, in the same 4 KB as the first bucket to avoid a TLB miss
+static inline uint64_t _filter_altBucket(uint64_t bucket, uint16_t fingerprint, uint64_t mask) {
+    return (bucket ^ ((fingerprint * 0x5bd1e995u) >> 23)) & mask;
+}
+
+#endif
+
+
+#ifdef FILTER_CUCKOO
+/**
+ * @brief Cuckoo filter
+ * @param buckets Fingerprints of each bucket (16 bits each, 0 if empty)
+ * @param mask Number of buckets - 1
+ * @param length Number of fingerprints in the filter
+ * @param victim Fingerprint that could not be inserted in a bucket (0 if none), the filter is full until it is removed
+ * @param victimBucket One of the 2 buckets of [victim]
+**/
+typedef struct {
+    uint64_t* buckets;
+    GEN_SIZE mask;
+    GEN_SIZE length;
+    uint16_t victim;
+    GEN_SIZE victimBucket;
+} GEN_ALGO;
+#else
+/**
+ * @brief Blocked Bloom filter
+ * @param blocks Bits of each block ([FILTER_BLOCK] words per block)
+ * @param length Number of blocks
+**/
+typedef struct {
+    uint32_t* blocks;
+    GEN_SIZE length;
+} GEN_ALGO;
+#endif
+
+
+/**
+ * @brief Initialize a filter
+ * @param filter The filter
+ * @param capacity Number of keys the filter is sized for
+**/
+void GEN_NAME(init)(GEN_ALGO* filter, GEN_SIZE capacity);
+
+
+/**
+ * @brief Create a filter
+ * @param capacity Number of keys the filter is sized for
+ * @return The filter
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
+    GEN_ALGO filter;
+    GEN_NAME(init)(&filter, capacity);
+    return filter;
+}
+
+
+/**
+ * @brief Free a filter
+ * @param filter The filter
+**/
+inline void GEN_NAME(free)(GEN_ALGO* filter) {
+#ifdef FILTER_CUCKOO
+    free(filter->buckets);
+#else
+    free(filter->blocks);
+#endif
+}
+
+
+/**
+ * @brief Remove all keys from a filter
+ * @param filter The filter
+**/
+void GEN_NAME(clear)(GEN_ALGO* filter);
+
+
+/**
+ * @brief Add the hash of a key to a filter
+ * @param filter The filter
+ * @param hash The hash of the key ([MAP_HASH])
+ * @return Whether the key was added if [FILTER_CUCKOO] (false if the filter is full)
+**/
+FILTER_ADD_TYPE GEN_NAME(addHash)(GEN_ALGO* filter, uint64_t hash);
+
+
+/**
+ * @brief Check whether a filter may contain the hash of a key
+ * @param filter The filter
+ * @param hash The hash of the key ([MAP_HASH])
+ * @return False if the key was not added, true if it was added or for a few keys that were not
+**/
+bool GEN_NAME(containsHash)(GEN_ALGO* filter, uint64_t hash);
+
+
+#ifdef FILTER_CUCKOO
+/**
+ * @brief Remove the hash of a key from a cuckoo filter (undefined if the key was not added)
+ * @param filter The filter
+ * @param hash The hash of the key ([MAP_HASH])
+**/
+void GEN_NAME(removeHash)(GEN_ALGO* filter, uint64_t hash);
+#endif
+
+
+/**
+ * @brief Add a key to a filter
+ * @param filter The filter
+ * @param key The key
+ * @return Whether the key was added if [FILTER_CUCKOO] (false if the filter is full)
+**/
+FILTER_ADD_TYPE GEN_NAME(add)(GEN_ALGO* filter, GEN_KEY key);
+
+
+/**
+ * @brief Check whether a filter may contain a key
+ * @param filter The filter
+ * @param key The key
+ * @return False if the key was not added, true if it was added or for a few keys that were not
+**/
+bool GEN_NAME(contains)(GEN_ALGO* filter, GEN_KEY key);
+
+
+#ifdef FILTER_CUCKOO
+/**
+ * @brief Remove a key from a cuckoo filter (undefined if the key was not added)
+ * @param filter The filter
+ * @param key The key
+**/
+void GEN_NAME(remove)(GEN_ALGO* filter, GEN_KEY key);
+#endif
+
+
+#ifdef GEN_SOURCE
+
+
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* filter);
+
+
+FILTER_ADD_TYPE GEN_NAME(add)(GEN_ALGO* filter, GEN_KEY key) {
+#ifdef FILTER_CUCKOO
+    return GEN_NAME(addHash)(filter, (uint64_t)MAP_HASH(key));
+#else
+    GEN_NAME(addHash)(filter, (uint64_t)MAP_HASH(key));
+#endif
+}
+
+
+bool GEN_NAME(contains)(GEN_ALGO* filter, GEN_KEY key) {
+    return GEN_NAME(containsHash)(filter, (uint64_t)MAP_HASH(key));
+}
+
+
+#ifdef FILTER_CUCKOO
+void GEN_NAME(remove)(GEN_ALGO* filter, GEN_KEY key) {
+    GEN_NAME(removeHash)(filter, (uint64_t)MAP_HASH(key));
+}
+#endif
+
+
+#ifdef FILTER_CUCKOO
+
+
+void GEN_NAME(init)(GEN_ALGO* filter, GEN_SIZE capacity) {
+    // Buckets at most 90% full
+    GEN_SIZE buckets = 1;
+    while ((double)buckets * FILTER_SLOTS * 0.9 < capacity) buckets <<= 1;
+    filter->buckets = THROW_PN(malloc(sizeof(uint64_t) * buckets), filter->buckets);
+    filter->mask = buckets - 1;
+    GEN_NAME(clear)(filter);
+}
+
+
+void GEN_NAME(clear)(GEN_ALGO* filter) {
+    memset(filter->buckets, 0, sizeof(uint64_t) * (filter->mask + 1));
+    filter->length = 0;
+    filter->victim = 0;
+}
+
+
+// Put a fingerprint in an empty slot of a bucket if there is one
+static inline bool GEN_NAME_(insert)(GEN_ALGO* filter, uint64_t bucket, uint16_t fingerprint) {
+    uint64_t* fingerprints = filter->buckets + bucket;
+    for (int i = 0; i < FILTER_SLOTS; i++) {
+        if ((uint16_t)(*fingerprints >> (i << 4)) == 0) {
+            *fingerprints |= (uint64_t)fingerprint << (i << 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Put a fingerprint in one of its 2 buckets, moving other fingerprints to their other bucket if both are full
+static void GEN_NAME_(place)(GEN_ALGO* filter, uint64_t bucket, uint16_t fingerprint) {
+    if (GEN_NAME_(insert)(filter, bucket, fingerprint)) return;
+    bucket = _filter_altBucket(bucket, fingerprint, filter->mask);
+    if (GEN_NAME_(insert)(filter, bucket, fingerprint)) return;
+    uint32_t random = fingerprint * 0x9E3779B9u;
+    for (int i = 0; i < FILTER_KICKS; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        int slot = (random >> 30) & (FILTER_SLOTS - 1);
+        uint64_t* fingerprints = filter->buckets + bucket;
+        uint16_t kicked = (uint16_t)(*fingerprints >> (slot << 4));
+        *fingerprints ^= (uint64_t)(uint16_t)(kicked ^ fingerprint) << (slot << 4);
+        fingerprint = kicked;
+        bucket = _filter_altBucket(bucket, fingerprint, filter->mask);
+        if (GEN_NAME_(insert)(filter, bucket, fingerprint)) return;
+    }
+    // The last moved fingerprint has no space left
+    filter->victim = fingerprint;
+    filter->victimBucket = bucket;
+}
+
+
+bool GEN_NAME(addHash)(GEN_ALGO* filter, uint64_t hash) {
+    if (filter->victim != 0) return false;
+    hash = hash_u64(hash);
+    filter->length++;
+    GEN_NAME_(place)(filter, (hash >> 32) & filter->mask, _filter_fingerprint(hash));
+    return true;
+}
+
+
+bool GEN_NAME(containsHash)(GEN_ALGO* filter, uint64_t hash) {
+    hash = hash_u64(hash);
+    uint16_t fingerprint = _filter_fingerprint(hash);
+    uint64_t bucket = (hash >> 32) & filter->mask;
+    uint64_t altBucket = _filter_altBucket(bucket, fingerprint, filter->mask);
+    return _filter_hasFingerprint(filter->buckets[bucket], fingerprint)
+        || _filter_hasFingerprint(filter->buckets[altBucket], fingerprint)
+        || (filter->victim == fingerprint && (filter->victimBucket == bucket || filter->victimBucket == altBucket));
+}
+
+
+// Remove a fingerprint from a bucket if found
+static inline bool GEN_NAME_(erase)(GEN_ALGO* filter, uint64_t bucket, uint16_t fingerprint) {
+    uint64_t* fingerprints = filter->buckets + bucket;
+    for (int i = 0; i < FILTER_SLOTS; i++) {
+        if ((uint16_t)(*fingerprints >> (i << 4)) == fingerprint) {
+            *fingerprints &= ~((uint64_t)0xFFFF << (i << 4));
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void GEN_NAME(removeHash)(GEN_ALGO* filter, uint64_t hash) {
+    hash = hash_u64(hash);
+    uint16_t fingerprint = _filter_fingerprint(hash);
+    uint64_t bucket = (hash >> 32) & filter->mask;
+    uint64_t altBucket = _filter_altBucket(bucket, fingerprint, filter->mask);
+    filter->length--;
+    if (filter->victim == fingerprint && (filter->victimBucket == bucket || filter->victimBucket == altBucket)) {
+        filter->victim = 0;
+        return;
+    }
+    if (!GEN_NAME_(erase)(filter, bucket, fingerprint)) GEN_NAME_(erase)(filter, altBucket, fingerprint);
+    // The victim may now fit in one of its buckets
+    if (filter->victim != 0) {
+        uint16_t victim = filter->victim;
+        filter->victim = 0;
+        GEN_NAME_(place)(filter, filter->victimBucket, victim);
+    }
+}
+
+
+#else
+
+
+void GEN_NAME(init)(GEN_ALGO* filter, GEN_SIZE capacity) {
+    filter->length = ((uint64_t)capacity * FILTER_BITS + 32 * FILTER_BLOCK - 1) / (32 * FILTER_BLOCK);
+    if (filter->length == 0) filter->length = 1;
+    filter->blocks = THROW_PN(aligned_alloc(32, sizeof(uint32_t) * FILTER_BLOCK * filter->length), filter->blocks);
+    GEN_NAME(clear)(filter);
+}
+
+
+void GEN_NAME(clear)(GEN_ALGO* filter) {
+    memset(filter->blocks, 0, sizeof(uint32_t) * FILTER_BLOCK * filter->length);
+}
+
+
+void GEN_NAME(addHash)(GEN_ALGO* filter, uint64_t hash) {
+    hash = hash_u64(hash);
+    uint32_t* block = filter->blocks + (((hash >> 32) * filter->length) >> 32) * FILTER_BLOCK;
+    uint32_t mask[FILTER_BLOCK];
+    _filter_blockMask((uint32_t)hash, mask);
+    for (int i = 0; i < FILTER_BLOCK; i++) block[i] |= mask[i];
+}
+
+
+bool GEN_NAME(containsHash)(GEN_ALGO* filter, uint64_t hash) {
+    hash = hash_u64(hash);
+    uint32_t* block = filter->blocks + (((hash >> 32) * filter->length) >> 32) * FILTER_BLOCK;
+    uint32_t mask[FILTER_BLOCK];
+    _filter_blockMask((uint32_t)hash, mask);
+    uint32_t missing = 0;
+    for (int i = 0; i < FILTER_BLOCK; i++) missing |= mask[i] & ~block[i];
+    return missing == 0;
+}
+
+
+#endif
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef FILTER_CUCKOO
+#undef FILTER_BITS
+#undef FILTER_ADD_TYPE
+
+#include "generic_end.h"
@@ -0,0 +1,475 @@
+#ifndef GEN_PREFIX
+#define GEN_PREFIX flatmap
+#endif
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "throw.h"
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys (default: the key)
+// The hash is mixed before use : the lowest 7 bits are used as a tag in the control bytes, the other bits select the first group
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+
+
+#ifndef FLATMAP_H
+#define FLATMAP_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Control bytes (full slots contain the 7-bit tag of their key)
+#define FLATMAP_EMPTY ((int8_t)-128)
+#define FLATMAP_DELETED ((int8_t)-2)
+#define FLATMAP_GROUP 16
+
+// Bit mask of the slots of a group with a given control byte
+static inline uint32_t _flatmap_match(const int8_t* ctrl, int8_t value) {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)ctrl), _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FLATMAP_GROUP; i++) mask |= (uint32_t)(ctrl[i] == value) << i;
+    return mask;
+#endif
+}
+
+// Bit mask of the empty or deleted slots of a group
+static inline uint32_t _flatmap_matchFree(const int8_t* ctrl) {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i*)ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FLATMAP_GROUP; i++) mask |= (uint32_t)(ctrl[i] < 0) << i;
+    return mask;
+#endif
+}
+
+#endif
+
+
+/**
+ * @brief Resizable hash map using open addressing with groups of 16 slots probed at once
+ * @param ctrl Control byte of each slot (tag of the key if full, [FLATMAP_EMPTY] or [FLATMAP_DELETED] otherwise)
+ * @param items Items of each slot
+ * @param length Number of items in the map
+ * @param mask Number of slots - 1
+ * @param growthLeft Number of empty slots that can still be filled before rehashing
+**/
+typedef struct {
+    int8_t* ctrl;
+    GEN_KV_TYPE* items;
+    GEN_SIZE length;
+    GEN_SIZE mask;
+    GEN_SIZE growthLeft;
+} GEN_ALGO;
+
+
+/**
+ * @brief Map iterator
+ * @param index Index of the slot
+**/
+typedef struct {
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Initialize a map
+ * @param map The map
+ * @param capacity Initial capacity (must be a power of 2)
+**/
+inline void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity) {
+    // Keep the number of slots at most half of the size range, so -1 is never a slot
+    if (capacity > (GEN_SIZE_MAX >> 2) + 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)(GEN_SIZE_MAX >> 2) + 1);
+    GEN_SIZE slots = capacity < FLATMAP_GROUP ? FLATMAP_GROUP : capacity << 1;
+    map->ctrl = THROW_PN(aligned_alloc(FLATMAP_GROUP, slots), map->ctrl);
+    map->items = THROW_PN(malloc(sizeof(GEN_KV_TYPE) * slots), map->items);
+    memset(map->ctrl, FLATMAP_EMPTY, slots);
+    map->length = 0;
+    map->mask = slots - 1;
+    map->growthLeft = slots - (slots >> 3);
+}
+
+
+/**
+ * @brief Create a map
+ * @param capacity Initial capacity (must be a power of 2)
+ * @return The map
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
+    GEN_ALGO map;
+    GEN_NAME(init)(&map, capacity);
+    return map;
+}
+
+
+/**
+ * @brief Free a map
+ * @param map The map
+**/
+inline void GEN_NAME(free)(GEN_ALGO* map) {
+    free(map->ctrl);
+    free(map->items);
+}
+
+
+#ifndef GEN_NO_VALUE
+
+
+/**
+ * @brief Get an item in a map
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added item), NULL if not found
+**/
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Get an item in a map or create it if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added);
+
+
+/**
+ * @brief Get an item in a map or create it with a default value if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param value Default value
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+inline GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added) {
+    bool _added;
+    GEN_TYPE* pValue = GEN_NAME(refOrEmpty)(map, key, &_added);
+    if (_added) *pValue = value;
+    if (added) *added = _added;
+    return pValue;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found (undefined otherwise)
+ * @param map The map
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key) {
+    return *GEN_NAME(ref)(map, key);
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found or a default value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(map, key);
+    return pValue == NULL ? value : *pValue;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map (undefined if not found)
+ * @param map The map
+ * @param key The key
+ * @param value New value
+**/
+inline void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME(ref)(map, key) = value;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map if found or create a new item with that value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value New value
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    *GEN_NAME(refOrEmpty)(map, key, &added) = value;
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Check whether a map contains a key
+ * @param map The map
+ * @param key The key
+ * @return Whether the key was found
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME(ref)(map, key) != NULL;
+}
+#endif
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Add an item with no value in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item
+**/
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key);
+#endif
+
+
+/**
+ * @brief Add an item in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+**/
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME_(addEmpty)(map, key) = value;
+}
+#endif
+
+
+/**
+ * @brief Add an item in a map if it does not already exist
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(refOrDefault)(map, key, value, &added);
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Remove an item in a map if found
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the removed item (usable until next added item)
+**/
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Start iterating on a map
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterStart)(void) {
+    return (GEN_NAME(iter)) { .index = GEN_NONE };
+}
+
+
+/**
+ * @brief Get the next item while iterating on a map
+ * @param map The map
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
+    while ((GEN_SIZE)(iter->index + 1) <= map->mask) {
+        if (map->ctrl[++iter->index] >= 0) return map->items + iter->index;
+    }
+    return NULL;
+}
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* map);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#endif
+GEN_NAME(iter) GEN_NAME(iterStart)();
+GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+
+
+static inline uint64_t GEN_NAME_(hash)(GEN_KEY key) {
+    uint64_t hash = (uint64_t)MAP_HASH(key) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+
+// Index of the slot of a key if found, -1 otherwise
+static GEN_SIZE GEN_NAME_(search)(GEN_ALGO* map, GEN_KEY key, uint64_t hash) {
+    GEN_SIZE groupMask = map->mask / FLATMAP_GROUP;
+    GEN_SIZE group = (hash >> 7) & groupMask;
+    int8_t tag = hash & 0x7F;
+    for (GEN_SIZE step = 1;; step++) { // Triangular probing over groups
+        GEN_SIZE first = group * FLATMAP_GROUP;
+        uint32_t match = _flatmap_match(map->ctrl + first, tag);
+        while (match) {
+            GEN_SIZE index = first + __builtin_ctz(match);
+            if (GEN_EQUALS(key, GEN_KV_KEY(map->items[index]))) return index;
+            match &= match - 1;
+        }
+        if (_flatmap_match(map->ctrl + first, FLATMAP_EMPTY)) return GEN_NONE;
+        group = (group + step) & groupMask;
+    }
+}
+
+
+// Index of the first empty or deleted slot for a hash
+static GEN_SIZE GEN_NAME_(findFree)(GEN_ALGO* map, uint64_t hash) {
+    GEN_SIZE groupMask = map->mask / FLATMAP_GROUP;
+    GEN_SIZE group = (hash >> 7) & groupMask;
+    for (GEN_SIZE step = 1;; step++) {
+        GEN_SIZE first = group * FLATMAP_GROUP;
+        uint32_t match = _flatmap_matchFree(map->ctrl + first);
+        if (match) return first + __builtin_ctz(match);
+        group = (group + step) & groupMask;
+    }
+}
+
+
+// Rebuild the map with a given number of slots, removing deleted slots
+static void GEN_NAME_(rehash)(GEN_ALGO* map, GEN_SIZE slots) {
+    int8_t* oldCtrl = map->ctrl;
+    GEN_KV_TYPE* oldItems = map->items;
+    GEN_SIZE oldSlots = map->mask + 1;
+    map->ctrl = THROW_PN(aligned_alloc(FLATMAP_GROUP, slots), map->ctrl);
+    map->items = THROW_PN(malloc(sizeof(GEN_KV_TYPE) * slots), map->items);
+    memset(map->ctrl, FLATMAP_EMPTY, slots);
+    map->mask = slots - 1;
+    map->growthLeft = slots - (slots >> 3) - map->length;
+    for (GEN_SIZE i = 0; i < oldSlots; i++) {
+        if (oldCtrl[i] < 0) continue;
+        uint64_t hash = GEN_NAME_(hash)(GEN_KV_KEY(oldItems[i]));
+        GEN_SIZE index = GEN_NAME_(findFree)(map, hash);
+        map->ctrl[index] = hash & 0x7F;
+        map->items[index] = oldItems[i];
+    }
+    free(oldCtrl);
+    free(oldItems);
+}
+
+
+// Fill a free slot for a key that is not in the map
+static GEN_KV_TYPE* GEN_NAME_(addItem)(GEN_ALGO* map, GEN_KEY key, uint64_t hash) {
+    GEN_SIZE index = GEN_NAME_(findFree)(map, hash);
+    if (map->growthLeft == 0 && map->ctrl[index] == FLATMAP_EMPTY) {
+        // Grow if more than half of the usable slots are full, only remove deleted slots otherwise
+        GEN_SIZE slots = map->mask + 1;
+        if (map->length >= (slots - (slots >> 3)) >> 1) {
+            if (map->mask >= GEN_SIZE_MAX >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)map->length);
+            slots <<= 1;
+        }
+        GEN_NAME_(rehash)(map, slots);
+        index = GEN_NAME_(findFree)(map, hash);
+    }
+    if (map->ctrl[index] == FLATMAP_EMPTY) map->growthLeft--;
+    map->ctrl[index] = hash & 0x7F;
+    map->length++;
+    GEN_KV_TYPE* item = map->items + index;
+    GEN_KV_KEY(*item) = key;
+    return item;
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME_(search)(map, key, GEN_NAME_(hash)(key)) != GEN_NONE;
+}
+#else
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key, GEN_NAME_(hash)(key));
+    return index == GEN_NONE ? NULL : &map->items[index].value;
+}
+#endif
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added) {
+#endif
+    uint64_t hash = GEN_NAME_(hash)(key);
+    GEN_SIZE index = GEN_NAME_(search)(map, key, hash);
+    if (index != GEN_NONE) {
+#ifdef GEN_NO_VALUE
+        return false;
+#else
+        if (added) *added = false;
+        return &map->items[index].value;
+#endif
+    }
+#ifdef GEN_NO_VALUE
+    GEN_NAME_(addItem)(map, key, hash);
+    return true;
+#else
+    if (added) *added = true;
+    return &GEN_NAME_(addItem)(map, key, hash)->value;
+#endif
+}
+
+
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_NAME_(addItem)(map, key, GEN_NAME_(hash)(key));
+}
+#else
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key) {
+    return &GEN_NAME_(addItem)(map, key, GEN_NAME_(hash)(key))->value;
+}
+#endif
+
+
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key, GEN_NAME_(hash)(key));
+    if (index == GEN_NONE) return 0;
+    // A group that still has an empty slot never stopped a probe, so the slot can become empty again
+    if (_flatmap_match(map->ctrl + (index & ~(GEN_SIZE)(FLATMAP_GROUP - 1)), FLATMAP_EMPTY)) {
+        map->ctrl[index] = FLATMAP_EMPTY;
+        map->growthLeft++;
+    }
+    else map->ctrl[index] = FLATMAP_DELETED;
+    map->length--;
+    return GEN_IF_VALUE(&map->items[index].value, true);
+}
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+
+#include "generic_end.h"
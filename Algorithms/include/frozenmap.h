@@ -0,0 +1,360 @@
+#define GEN_PREFIX frozenmap
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "throw.h"
+#include "hash.h"
+
+// Immutable hash map built once from all its items, using a minimal perfect hash function (PTHash)
+// Each key is assigned to a bucket, and each bucket has a pilot chosen so that the keys of all buckets get distinct slots
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys (default: the key)
+// FROZENMAP_LAMBDA : Average number of keys per bucket, higher uses less memory but takes longer to build (default: 4)
+// FROZENMAP_MAP : Whether to define [fromMap], a map with the same parameters and the same suffix must be included before (default: false)
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+#ifndef FROZENMAP_LAMBDA
+#define FROZENMAP_LAMBDA 4
+#endif
+
+
+#ifndef FROZENMAP_H
+#define FROZENMAP_H
+
+// Number of seeds tried before giving up (the keys are probably not distinct)
+#define FROZENMAP_SEEDS 16
+
+// Hash of a key with a given seed
+static inline uint64_t _frozenmap_hash(uint64_t hash, uint64_t seed) {
+    return hash_u64(hash ^ seed);
+}
+
+// Reduce a 64-bit hash to [0, n)
+static inline uint64_t _frozenmap_reduce(uint64_t hash, uint64_t n) {
+    return (uint64_t)(((__uint128_t)hash * n) >> 64);
+}
+
+// Slot of a key in a table of [slots] slots with a given pilot
+// The hash is multiplied so that the keys of a bucket, which share their higher bits, get unrelated slots
+static inline uint64_t _frozenmap_slot(uint64_t hash, uint16_t pilot, uint64_t slots) {
+    return _frozenmap_reduce((hash * 0xC2B2AE3D27D4EB4Full) ^ hash_u64(pilot), slots);
+}
+
+#endif
+
+
+/**
+ * @brief Immutable hash map
+ * @param items Items of each slot
+ * @param pilots Pilot of each bucket
+ * @param remap Slot in [0, length) of each slot in [length, slots)
+ * @param length Number of items in the map
+ * @param slots Number of slots the keys are assigned to (slightly more than [length] to speed up building)
+ * @param buckets Number of buckets
+ * @param seed Seed of the hash of the keys
+**/
+typedef struct {
+    GEN_KV_TYPE* items;
+    uint16_t* pilots;
+    GEN_SIZE* remap;
+    GEN_SIZE length;
+    GEN_SIZE slots;
+    GEN_SIZE buckets;
+    uint64_t seed;
+} GEN_ALGO;
+
+
+/**
+ * @brief Map iterator
+ * @param index Index of the item in [items]
+**/
+typedef struct {
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Create a map from the keys (and values) of arrays (the keys must be distinct)
+ * @param keys Keys of the items
+ * @param values Values of the items
+ * @param n Number of items
+ * @return The map
+**/
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_SIZE n);
+#else
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n);
+#endif
+
+
+#ifdef FROZENMAP_MAP
+/**
+ * @brief Create a map containing the items of a map
+ * @param map The map
+ * @return The frozen map
+**/
+GEN_ALGO GEN_NAME(fromMap)(GEN_ALGO_OF(map)* map);
+#endif
+
+
+/**
+ * @brief Free a map
+ * @param map The map
+**/
+inline void GEN_NAME(free)(GEN_ALGO* map) {
+    free(map->items);
+    free(map->pilots);
+    free(map->remap);
+}
+
+
+/**
+ * @brief Get the only item of a map that may contain a key
+ * @param map The map
+ * @param key The key
+ * @return The item
+**/
+GEN_KV_TYPE* GEN_NAME_(item)(GEN_ALGO* map, GEN_KEY key);
+
+
+#ifndef GEN_NO_VALUE
+
+
+/**
+ * @brief Get an item in a map
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item, NULL if not found
+**/
+inline GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key) {
+    if (map->length == 0) return NULL;
+    GEN_KV_TYPE* item = GEN_NAME_(item)(map, key);
+    return GEN_EQUALS(key, item->key) ? &item->value : NULL;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found (undefined otherwise)
+ * @param map The map
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME_(item)(map, key)->value;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found or a default value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(map, key);
+    return pValue == NULL ? value : *pValue;
+}
+#endif
+
+
+/**
+ * @brief Check whether a map contains a key
+ * @param map The map
+ * @param key The key
+ * @return Whether the key was found
+**/
+inline bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return map->length != 0 && GEN_EQUALS(key, GEN_KV_KEY(*GEN_NAME_(item)(map, key)));
+}
+
+
+/**
+ * @brief Start iterating on a map
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterStart)(void) {
+    return (GEN_NAME(iter)) { .index = 0 };
+}
+
+
+/**
+ * @brief Get the next item while iterating on a map
+ * @param map The map
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
+    return iter->index < map->length ? map->items + iter->index++ : NULL;
+}
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(free)(GEN_ALGO* map);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+#endif
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+GEN_NAME(iter) GEN_NAME(iterStart)();
+GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+
+
+GEN_KV_TYPE* GEN_NAME_(item)(GEN_ALGO* map, GEN_KEY key) {
+    uint64_t hash = _frozenmap_hash((uint64_t)MAP_HASH(key), map->seed);
+    uint16_t pilot = map->pilots[_frozenmap_reduce(hash, map->buckets)];
+    GEN_SIZE slot = _frozenmap_slot(hash, pilot, map->slots);
+    if (slot >= map->length) slot = map->remap[slot - map->length];
+    return map->items + slot;
+}
+
+
+// Try to find a pilot for each bucket with a given seed, and fill [slots] with the slot of each key
+static bool GEN_NAME_(build)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE* slots) {
+    GEN_SIZE n = map->length;
+    uint64_t* hashes = THROW_PN(malloc(sizeof(uint64_t) * (n + 1)), hashes);
+    GEN_SIZE* bucketStarts = THROW_PN(calloc(map->buckets + 1, sizeof(GEN_SIZE)), bucketStarts);
+    GEN_SIZE* order = THROW_PN(malloc(sizeof(GEN_SIZE) * (n + 1)), order);
+    uint64_t* taken = THROW_PN(calloc(((uint64_t)map->slots >> 6) + 1, sizeof(uint64_t)), taken);
+
+    // Counting sort of the keys by bucket
+    for (GEN_SIZE i = 0; i < n; i++) {
+        hashes[i] = _frozenmap_hash((uint64_t)MAP_HASH(keys[i]), map->seed);
+        bucketStarts[_frozenmap_reduce(hashes[i], map->buckets) + 1]++;
+    }
+    GEN_SIZE maxSize = 0;
+    for (GEN_SIZE i = 0; i < map->buckets; i++) {
+        if (bucketStarts[i + 1] > maxSize) maxSize = bucketStarts[i + 1];
+        bucketStarts[i + 1] += bucketStarts[i];
+    }
+    GEN_SIZE* cursors = THROW_PN(malloc(sizeof(GEN_SIZE) * (map->buckets + 1)), cursors);
+    memcpy(cursors, bucketStarts, sizeof(GEN_SIZE) * (map->buckets + 1));
+    for (GEN_SIZE i = 0; i < n; i++) order[cursors[_frozenmap_reduce(hashes[i], map->buckets)]++] = i;
+
+    // Counting sort of the buckets by decreasing size, so that the largest buckets are placed while most slots are free
+    GEN_SIZE* sizeStarts = THROW_PN(calloc(maxSize + 2, sizeof(GEN_SIZE)), sizeStarts);
+    for (GEN_SIZE i = 0; i < map->buckets; i++) sizeStarts[maxSize - (bucketStarts[i + 1] - bucketStarts[i]) + 1]++;
+    for (GEN_SIZE i = 0; i <= maxSize; i++) sizeStarts[i + 1] += sizeStarts[i];
+    for (GEN_SIZE i = 0; i < map->buckets; i++) cursors[sizeStarts[maxSize - (bucketStarts[i + 1] - bucketStarts[i])]++] = i;
+    free(sizeStarts);
+
+    // Find the first pilot that gives free and distinct slots to all the keys of each bucket
+    bool success = true;
+    for (GEN_SIZE i = 0; i < map->buckets && success; i++) {
+        GEN_SIZE bucket = cursors[i];
+        GEN_SIZE start = bucketStarts[bucket], end = bucketStarts[bucket + 1];
+        if (start == end) break;
+        uint32_t pilot = 0;
+        for (; pilot <= UINT16_MAX; pilot++) {
+            GEN_SIZE j = start;
+            for (; j < end; j++) {
+                GEN_SIZE slot = _frozenmap_slot(hashes[order[j]], pilot, map->slots);
+                if (taken[slot >> 6] >> (slot & 63) & 1) break;
+                taken[slot >> 6] |= 1ull << (slot & 63);
+                slots[order[j]] = slot;
+            }
+            if (j == end) break;
+            for (GEN_SIZE k = start; k < j; k++) taken[slots[order[k]] >> 6] &= ~(1ull << (slots[order[k]] & 63));
+        }
+        if (pilot > UINT16_MAX) success = false;
+        else map->pilots[bucket] = pilot;
+    }
+
+    // Give the free slots in [0, length) to the keys in slots in [length, slots)
+    if (success) {
+        GEN_SIZE freeSlot = 0;
+        for (GEN_SIZE i = n; i < map->slots; i++) {
+            // Unused slots can only be reached by keys that are not in the map, any item can be compared to them
+            if (!(taken[i >> 6] >> (i & 63) & 1)) {
+                map->remap[i - n] = 0;
+                continue;
+            }
+            while (taken[freeSlot >> 6] >> (freeSlot & 63) & 1) freeSlot++;
+            map->remap[i - n] = freeSlot++;
+        }
+    }
+
+    free(hashes);
+    free(bucketStarts);
+    free(order);
+    free(taken);
+    free(cursors);
+    return success;
+}
+
+
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_SIZE n) {
+#else
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n) {
+#endif
+    GEN_ALGO map;
+    map.length = n;
+    map.slots = n + (n >> 4);
+    map.buckets = n / FROZENMAP_LAMBDA + 1;
+    map.items = THROW_PN(malloc(sizeof(GEN_KV_TYPE) * (n + 1)), map.items);
+    map.pilots = THROW_PN(calloc(map.buckets, sizeof(uint16_t)), map.pilots);
+    map.remap = THROW_PN(malloc(sizeof(GEN_SIZE) * (map.slots - n + 1)), map.remap);
+    GEN_SIZE* slots = THROW_PN(malloc(sizeof(GEN_SIZE) * (n + 1)), slots);
+    map.seed = 0;
+    while (!GEN_NAME_(build)(&map, keys, slots)) {
+        if (++map.seed == FROZENMAP_SEEDS) THROW_ERR("Could not build frozen map (duplicate keys ?)");
+    }
+    for (GEN_SIZE i = 0; i < n; i++) {
+        GEN_SIZE slot = slots[i] < n ? slots[i] : map.remap[slots[i] - n];
+        GEN_KV_KEY(map.items[slot]) = keys[i];
+#ifndef GEN_NO_VALUE
+        map.items[slot].value = values[i];
+#endif
+    }
+    free(slots);
+    return map;
+}
+
+
+#ifdef FROZENMAP_MAP
+GEN_ALGO GEN_NAME(fromMap)(GEN_ALGO_OF(map)* map) {
+    GEN_KEY* keys = THROW_PN(malloc(sizeof(GEN_KEY) * (map->length + 1)), keys);
+#ifndef GEN_NO_VALUE
+    GEN_TYPE* values = THROW_PN(malloc(sizeof(GEN_TYPE) * (map->length + 1)), values);
+#endif
+    GEN_SIZE n = 0;
+    GEN_NAME_OF(map, iter) iter = GEN_NAME_OF(map, iterStart)();
+#ifdef GEN_NO_VALUE
+    GEN_KEY* item;
+    while ((item = GEN_NAME_OF(map, iterNext)(map, &iter))) keys[n++] = *item;
+    GEN_ALGO frozen = GEN_NAME(fromArrays)(keys, n);
+#else
+    GEN_NAME_OF(map, kv)* item;
+    while ((item = GEN_NAME_OF(map, iterNext)(map, &iter))) {
+        keys[n] = item->key;
+        values[n++] = item->value;
+    }
+    GEN_ALGO frozen = GEN_NAME(fromArrays)(keys, values, n);
+    free(values);
+#endif
+    free(keys);
+    return frozen;
+}
+#endif
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef FROZENMAP_LAMBDA
+#undef FROZENMAP_MAP
+
+#include "generic_end.h"
@@ -14,4 +14,6 @@
 #undef GEN_IF_VALUE
 #undef GEN_ALGO
 #undef GEN_NAME
-#undef GEN_NAME_
\ No newline at end of file
+#undef GEN_NAME_
+#undef GEN_ALGO_OF
+#undef GEN_NAME_OF
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include <stdint.h>
+#include <limits.h>
 
 // Common parameters : (not all parameters are applicable for every algorithm)
 // GEN_TYPE : data type (default: void*)
 // GEN_KEY : key type (default: int32_t)
 // GEN_SUFFIX : suffix added after every function and struct name (default: "")
-// GEN_SIZE : type used for sizes and indices (must be able to contain the number of items) (default: int32_t)
+// GEN_SIZE : signed or unsigned integer type used for sizes and indices, can be as small as 8 bits (must be able to contain the number of items, growing beyond it throws an error) (default: int32_t)
 // GEN_COMPARE : comparator for keys or items (default: a > b ? 1 : a < b ? -1 : 0)
 // GEN_EQUALS : equality function for keys or items (default: a == b)
 // GEN_COMPARE_TYPE : type used for comparisons (returned by GEN_COMPARE) (default: int)
@@ -24,6 +25,22 @@
 #define __GEN_CAT5(A, B, C, D, E) A ## B ## C ## D ## E
 #define _GEN_CAT5(A, B, C, D, E) __GEN_CAT5(A, B, C, D, E)
 
+// Whether GEN_SIZE is a signed type
+#define GEN_SIZE_SIGNED ((GEN_SIZE)-1 < 0)
+
+// Sentinel index, cast so that comparisons also work for unsigned types narrower than int
+#define GEN_NONE ((GEN_SIZE)-1)
+
+// Largest value of GEN_SIZE
+#define GEN_SIZE_MAX (GEN_SIZE_SIGNED ? \
+    (GEN_SIZE)((((GEN_SIZE)1 << (sizeof(GEN_SIZE) * CHAR_BIT - 2)) - 1) * 2 + 1) : (GEN_SIZE)-1)
+
+// Double a capacity (at least 1, at most GEN_SIZE_MAX), throw an error if it is already GEN_SIZE_MAX
+#define GEN_GROW(capacity) do { \
+    if ((capacity) == GEN_SIZE_MAX) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)GEN_SIZE_MAX); \
+    (capacity) = (capacity) > GEN_SIZE_MAX >> 1 ? GEN_SIZE_MAX : (capacity) == 0 ? 1 : (capacity) << 1; \
+} while (0)
+
 #endif
 
 
@@ -64,6 +81,10 @@
 #define GEN_NAME(name) _GEN_CAT4(GEN_PREFIX, _, name, GEN_SUFFIX_)
 #define GEN_NAME_(name) _GEN_CAT5(_, GEN_PREFIX, _, name, GEN_SUFFIX_)
 
+// Struct and function names of another algorithm included with the same suffix
+#define GEN_ALGO_OF(prefix) _GEN_CAT2(prefix, GEN_SUFFIX_)
+#define GEN_NAME_OF(prefix, name) _GEN_CAT4(prefix, _, name, GEN_SUFFIX_)
+
 
 // Key-value or only key
 #ifdef GEN_KV
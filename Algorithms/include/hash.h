@@ -0,0 +1,131 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+// Hash functions that can be used as MAP_HASH, for example :
+// #define MAP_HASH hash_u32
+// #define MAP_HASH(key) hash_bytes(&(key), sizeof(key), 0)
+
+#define HASH_P0 0xa0761d6478bd642full
+#define HASH_P1 0xe7037ed1a0b428dbull
+
+
+/**
+ * @brief Hash a 32-bit integer (multiply-xorshift)
+ * @param x The integer
+ * @return The hash
+**/
+static inline uint32_t hash_u32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+
+/**
+ * @brief Hash a 64-bit integer or a pointer (multiply-xorshift)
+ * @param x The integer
+ * @return The hash
+**/
+static inline uint64_t hash_u64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+
+/**
+ * @brief Hash a 64-bit integer using the CRC32 instruction if SSE4.2 is available (compile with -msse4.2)
+ * Faster but less mixed than [hash_u64], the lower bits are well distributed
+ * @param x The integer
+ * @return The hash
+**/
+static inline uint32_t hash_crc32(uint64_t x) {
+#ifdef __SSE4_2__
+    return (uint32_t)_mm_crc32_u64(0xFFFFFFFF, x);
+#else
+    return (uint32_t)hash_u64(x);
+#endif
+}
+
+
+// 64x64 -> 128 bit multiplication folded to 64 bits
+static inline uint64_t _hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t _hash_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t _hash_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+
+/**
+ * @brief Hash a buffer (wyhash)
+ * @param data The buffer
+ * @param n Size of the buffer in bytes
+ * @param seed Seed of the hash
+ * @return The hash
+**/
+static inline uint64_t hash_bytes(const void* data, size_t n, uint64_t seed) {
+    const uint8_t* p = data;
+    seed ^= _hash_mix(seed ^ HASH_P0, HASH_P1);
+    uint64_t a, b;
+    if (n <= 16) {
+        if (n >= 4) {
+            size_t mid = (n >> 3) << 2;
+            a = (_hash_read32(p) << 32) | _hash_read32(p + mid);
+            b = (_hash_read32(p + n - 4) << 32) | _hash_read32(p + n - 4 - mid);
+        }
+        else if (n > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[n >> 1] << 8) | p[n - 1];
+            b = 0;
+        }
+        else a = b = 0;
+    }
+    else {
+        size_t i = n;
+        while (i > 16) {
+            seed = _hash_mix(_hash_read64(p) ^ HASH_P1, _hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = _hash_read64(p + i - 16);
+        b = _hash_read64(p + i - 8);
+    }
+    __uint128_t r = (__uint128_t)(a ^ HASH_P1) * (b ^ seed);
+    return _hash_mix((uint64_t)r ^ HASH_P0 ^ n, (uint64_t)(r >> 64) ^ HASH_P1);
+}
+
+
+/**
+ * @brief Hash a null-terminated string (wyhash)
+ * @param s The string
+ * @return The hash
+**/
+static inline uint64_t hash_string(const char* s) {
+    return hash_bytes(s, strlen(s), 0);
+}
+
+
+#endif
@@ -81,7 +81,7 @@ inline void GEN_NAME(init)(GEN_ALGO* heap, GEN_SIZE capacity) {
     heap->heap = THROW_PN(malloc(sizeof(HEAP_NODE_TYPE) * capacity), heap->heap);
 #ifdef HEAP_INDEXED
     heap->items = THROW_PN(malloc(sizeof(GEN_NAME_(item)) * capacity), heap->heap);
-    heap->reusable = -1;
+    heap->reusable = GEN_NONE;
 #endif
     heap->length = 0;
     heap->capacity = capacity;
@@ -309,8 +309,8 @@ GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* heap, GEN_NAME(iter)* iter);
 
 
 inline void GEN_NAME_(grow)(GEN_ALGO* heap) {
-    if (heap->length >= heap->capacity - 1) {
-        heap->capacity <<= 1;
+    if (heap->length + 1 >= heap->capacity) {
+        GEN_GROW(heap->capacity);
         heap->heap = THROW_PN(realloc(heap->heap, sizeof(HEAP_NODE_TYPE) * heap->capacity), heap->heap);
 #ifdef HEAP_INDEXED
         heap->items = THROW_PN(realloc(heap->items, sizeof(GEN_NAME_(item)) * heap->capacity), heap->items);
@@ -324,7 +324,7 @@ inline void GEN_NAME_(grow)(GEN_ALGO* heap) {
 GEN_SIZE GEN_NAME_(addEmpty)(GEN_ALGO* heap, GEN_KEY key) {
     GEN_NAME_(grow)(heap);
     GEN_SIZE i;
-    if (heap->reusable != -1) {
+    if (heap->reusable != GEN_NONE) {
         i = heap->reusable;
         heap->reusable = heap->items[i].index;
     }
@@ -366,8 +366,8 @@ void GEN_NAME_(heapifyUp)(GEN_ALGO* heap, GEN_SIZE index, HEAP_NODE_TYPE node) {
 
 void GEN_NAME_(heapifyDown)(GEN_ALGO* heap, GEN_SIZE index, HEAP_NODE_TYPE node) {
     GEN_KEY key = HEAP_KEY(heap, node);
-    GEN_SIZE childIndex = index << 1;
-    while (childIndex <= heap->length) {
+    while (index <= heap->length >> 1) { // Children exist (and their index does not overflow)
+        GEN_SIZE childIndex = index << 1;
         HEAP_NODE_TYPE child = heap->heap[childIndex];
         if (childIndex + 1 <= heap->length) {
             HEAP_NODE_TYPE child2 = heap->heap[childIndex + 1];
@@ -382,7 +382,6 @@ void GEN_NAME_(heapifyDown)(GEN_ALGO* heap, GEN_SIZE index, HEAP_NODE_TYPE node)
         heap->items[child].index = index;
 #endif
         index = childIndex;
-        childIndex <<= 1;
     }
     heap->heap[index] = node;
 #ifdef HEAP_MODIFIABLE
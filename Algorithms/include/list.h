@@ -56,7 +56,7 @@ inline void GEN_NAME(free)(GEN_ALGO* list) {
 **/
 inline void GEN_NAME_(grow)(GEN_ALGO* list) {
     if (list->length >= list->capacity) {
-        list->capacity <<= 1;
+        GEN_GROW(list->capacity);
         list->values = THROW_PN(realloc(list->values, sizeof(GEN_TYPE) * list->capacity), list->values);
     }
 }
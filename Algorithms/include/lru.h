@@ -0,0 +1,392 @@
+#define GEN_PREFIX lru
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "throw.h"
+
+// Fixed capacity cache that evicts the least recently used item when full
+// Items are stored like in a map (linked lists of items for each hash value), with a second doubly linked list
+// through the same items from the most to the least recently used one, so that an access touches a single item
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys, see hash.h for well mixed hash functions (default: the key)
+// MAP_HASH_TYPE : Type of the hashes (default: uint32_t)
+// MAP_INDEX : Conversion from a hash to an index in a cache with a given mask (default: (hash ^ (hash >> 16)) & mask)
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+#ifndef MAP_HASH_TYPE
+#define MAP_HASH_TYPE uint32_t
+#endif
+#ifndef MAP_INDEX
+#define MAP_INDEX(hash, mask) (((hash) ^ (hash >> 16)) & (mask))
+#endif
+
+
+/**
+ * @brief Cache item
+ * @param kv Key-value pair
+ * @param next Index of the next item in the bucket (-1 if last) or of the next reusable item if the item was removed
+ * @param newer Index of the item used just after this one (-1 if most recently used)
+ * @param older Index of the item used just before this one (-1 if least recently used)
+**/
+typedef struct {
+    GEN_SIZE next;
+    GEN_SIZE newer;
+    GEN_SIZE older;
+    GEN_KV_TYPE kv;
+} GEN_NAME_(item);
+
+
+/**
+ * @brief Least recently used cache
+ * @param items Items in the cache
+ * @param buckets Linked list of items for each hash value
+ * @param length Number of items in the cache
+ * @param capacity Size of [items], maximum number of items
+ * @param mask Size of [buckets] - 1
+ * @param newest Index of the most recently used item (-1 if empty)
+ * @param oldest Index of the least recently used item, evicted first (-1 if empty)
+ * @param reusable Index of the first removed item in [items]
+ * @param end Number of items at the start of [items] that are in the cache or removed
+ * @param evict Function called on items evicted to make space for new items (NULL if none)
+ * @param arg Argument passed to [evict]
+**/
+typedef struct {
+    GEN_NAME_(item)* items;
+    GEN_SIZE* buckets;
+    GEN_SIZE length;
+    GEN_SIZE capacity;
+    GEN_SIZE mask;
+    GEN_SIZE newest;
+    GEN_SIZE oldest;
+    GEN_SIZE reusable;
+    GEN_SIZE end;
+    void (*evict)(GEN_KV_TYPE* item, void* arg);
+    void* arg;
+} GEN_ALGO;
+
+
+/**
+ * @brief Cache iterator
+ * @param index Index of the item in [items]
+**/
+typedef struct {
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Initialize a cache
+ * @param lru The cache
+ * @param capacity Maximum number of items (at least 1)
+ * @param evict Function called on items evicted to make space for new items (NULL if none)
+ * @param arg Argument passed to [evict]
+**/
+inline void GEN_NAME(init)(GEN_ALGO* lru, GEN_SIZE capacity, void (*evict)(GEN_KV_TYPE* item, void* arg), void* arg) {
+    // Keep the number of buckets at most half of the size range
+    if (capacity > (GEN_SIZE_MAX >> 2) + 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)(GEN_SIZE_MAX >> 2) + 1);
+    GEN_SIZE buckets = 1;
+    while (buckets < capacity << 1) buckets <<= 1;
+    lru->items = THROW_PN(malloc(sizeof(GEN_NAME_(item)) * capacity), lru->items);
+    lru->buckets = THROW_PN(malloc(sizeof(GEN_SIZE) * buckets), lru->buckets);
+    memset(lru->buckets, -1, sizeof(GEN_SIZE) * buckets);
+    lru->length = 0;
+    lru->capacity = capacity;
+    lru->mask = buckets - 1;
+    lru->newest = GEN_NONE;
+    lru->oldest = GEN_NONE;
+    lru->reusable = GEN_NONE;
+    lru->end = 0;
+    lru->evict = evict;
+    lru->arg = arg;
+}
+
+
+/**
+ * @brief Create a cache
+ * @param capacity Maximum number of items (at least 1)
+ * @param evict Function called on items evicted to make space for new items (NULL if none)
+ * @param arg Argument passed to [evict]
+ * @return The cache
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity, void (*evict)(GEN_KV_TYPE* item, void* arg), void* arg) {
+    GEN_ALGO lru;
+    GEN_NAME(init)(&lru, capacity, evict, arg);
+    return lru;
+}
+
+
+/**
+ * @brief Free a cache (items are not evicted)
+ * @param lru The cache
+**/
+inline void GEN_NAME(free)(GEN_ALGO* lru) {
+    free(lru->items);
+    free(lru->buckets);
+}
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Get an item in a cache and mark it as the most recently used one
+ * @param lru The cache
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added item), NULL if not found
+**/
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* lru, GEN_KEY key);
+
+
+/**
+ * @brief Get the value associated with a key in a cache and mark it as the most recently used one
+ * @param lru The cache
+ * @param key The key
+ * @param value Default value
+ * @return The value if found, the default value otherwise
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* lru, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(lru, key);
+    return pValue == NULL ? value : *pValue;
+}
+
+
+/**
+ * @brief Get an item in a cache without changing the order of use
+ * @param lru The cache
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added item), NULL if not found
+**/
+GEN_TYPE* GEN_NAME(peek)(GEN_ALGO* lru, GEN_KEY key);
+#endif
+
+
+/**
+ * @brief Mark an item of a cache as the most recently used one if found
+ * @param lru The cache
+ * @param key Key of the item
+ * @return Whether the key was found
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(touch)(GEN_ALGO* lru, GEN_KEY key);
+#else
+inline bool GEN_NAME(touch)(GEN_ALGO* lru, GEN_KEY key) {
+    return GEN_NAME(ref)(lru, key) != NULL;
+}
+#endif
+
+
+/**
+ * @brief Check whether a cache contains a key without changing the order of use
+ * @param lru The cache
+ * @param key The key
+ * @return Whether the key was found
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* lru, GEN_KEY key);
+#else
+inline bool GEN_NAME(contains)(GEN_ALGO* lru, GEN_KEY key) {
+    return GEN_NAME(peek)(lru, key) != NULL;
+}
+#endif
+
+
+/**
+ * @brief Add an item to a cache or replace its value if found, and mark it as the most recently used one
+ * The least recently used item is evicted if the cache is full
+ * @param lru The cache
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(put)(GEN_ALGO* lru, GEN_KEY key);
+#else
+bool GEN_NAME(put)(GEN_ALGO* lru, GEN_KEY key, GEN_TYPE value);
+#endif
+
+
+/**
+ * @brief Remove an item from a cache if found (without calling [evict])
+ * @param lru The cache
+ * @param key Key of the item
+ * @return Pointer to the removed item (usable until next added item)
+**/
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* lru, GEN_KEY key);
+
+
+/**
+ * @brief Start iterating on a cache, from the most to the least recently used item
+ * @param lru The cache
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterStart)(GEN_ALGO* lru) {
+    return (GEN_NAME(iter)) { .index = lru->newest };
+}
+
+
+/**
+ * @brief Get the next item while iterating on a cache
+ * @param lru The cache
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* lru, GEN_NAME(iter)* iter) {
+    if (iter->index == GEN_NONE) return NULL;
+    GEN_NAME_(item)* item = lru->items + iter->index;
+    iter->index = item->older;
+    return &item->kv;
+}
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* lru, GEN_SIZE capacity, void (*evict)(GEN_KV_TYPE* item, void* arg), void* arg);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity, void (*evict)(GEN_KV_TYPE* item, void* arg), void* arg);
+void GEN_NAME(free)(GEN_ALGO* lru);
+#ifndef GEN_NO_VALUE
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* lru, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(touch)(GEN_ALGO* lru, GEN_KEY key);
+bool GEN_NAME(contains)(GEN_ALGO* lru, GEN_KEY key);
+#endif
+GEN_NAME(iter) GEN_NAME(iterStart)(GEN_ALGO* lru);
+GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* lru, GEN_NAME(iter)* iter);
+
+
+// Pointer to the index of an item in the linked list of a bucket, pointer to -1 if not found
+static inline GEN_SIZE* GEN_NAME_(search)(GEN_ALGO* lru, GEN_KEY key) {
+    MAP_HASH_TYPE hash = MAP_HASH(key);
+    GEN_SIZE* index = lru->buckets + MAP_INDEX(hash, lru->mask);
+    while (*index != GEN_NONE) {
+        GEN_NAME_(item)* item = lru->items + *index;
+        if (GEN_EQUALS(key, GEN_KV_KEY(item->kv))) return index;
+        index = &item->next;
+    }
+    return index;
+}
+
+
+// Remove an item from the order of use
+static inline void GEN_NAME_(unlink)(GEN_ALGO* lru, GEN_NAME_(item)* item) {
+    if (item->newer == GEN_NONE) lru->newest = item->older;
+    else lru->items[item->newer].older = item->older;
+    if (item->older == GEN_NONE) lru->oldest = item->newer;
+    else lru->items[item->older].newer = item->newer;
+}
+
+
+// Insert an item as the most recently used one
+static inline void GEN_NAME_(pushNewest)(GEN_ALGO* lru, GEN_SIZE index) {
+    GEN_NAME_(item)* item = lru->items + index;
+    item->newer = GEN_NONE;
+    item->older = lru->newest;
+    if (lru->newest == GEN_NONE) lru->oldest = index;
+    else lru->items[lru->newest].newer = index;
+    lru->newest = index;
+}
+
+
+// Mark an item as the most recently used one
+static inline void GEN_NAME_(promote)(GEN_ALGO* lru, GEN_SIZE index) {
+    if (index == lru->newest) return;
+    GEN_NAME_(unlink)(lru, lru->items + index);
+    GEN_NAME_(pushNewest)(lru, index);
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(touch)(GEN_ALGO* lru, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* lru, GEN_KEY key) {
+#endif
+    GEN_SIZE index = *GEN_NAME_(search)(lru, key);
+    if (index == GEN_NONE) return 0;
+    GEN_NAME_(promote)(lru, index);
+    return GEN_IF_VALUE(&lru->items[index].kv.value, true);
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* lru, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(peek)(GEN_ALGO* lru, GEN_KEY key) {
+#endif
+    GEN_SIZE index = *GEN_NAME_(search)(lru, key);
+    if (index == GEN_NONE) return 0;
+    return GEN_IF_VALUE(&lru->items[index].kv.value, true);
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(put)(GEN_ALGO* lru, GEN_KEY key) {
+#else
+bool GEN_NAME(put)(GEN_ALGO* lru, GEN_KEY key, GEN_TYPE value) {
+#endif
+    GEN_SIZE* bucket = GEN_NAME_(search)(lru, key);
+    GEN_SIZE index = *bucket;
+    if (index != GEN_NONE) {
+        GEN_NAME_(promote)(lru, index);
+#ifndef GEN_NO_VALUE
+        lru->items[index].kv.value = value;
+#endif
+        return false;
+    }
+
+    if (lru->reusable != GEN_NONE) {
+        index = lru->reusable;
+        lru->reusable = lru->items[index].next;
+    }
+    else if (lru->end < lru->capacity) index = lru->end++;
+    else {
+        // Evict the least recently used item and reuse it
+        index = lru->oldest;
+        GEN_NAME_(item)* oldest = lru->items + index;
+        GEN_SIZE* oldBucket = GEN_NAME_(search)(lru, GEN_KV_KEY(oldest->kv));
+        *oldBucket = oldest->next;
+        // The new item is at the end of its bucket, which may have been the evicted item
+        if (bucket == &oldest->next) bucket = oldBucket;
+        GEN_NAME_(unlink)(lru, oldest);
+        lru->length--;
+        if (lru->evict) lru->evict(&oldest->kv, lru->arg);
+    }
+
+    GEN_NAME_(item)* item = lru->items + index;
+    item->next = GEN_NONE;
+    GEN_KV_KEY(item->kv) = key;
+#ifndef GEN_NO_VALUE
+    item->kv.value = value;
+#endif
+    *bucket = index;
+    GEN_NAME_(pushNewest)(lru, index);
+    lru->length++;
+    return true;
+}
+
+
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* lru, GEN_KEY key) {
+    GEN_SIZE* bucket = GEN_NAME_(search)(lru, key);
+    GEN_SIZE index = *bucket;
+    if (index == GEN_NONE) return 0;
+    GEN_NAME_(item)* item = lru->items + index;
+    *bucket = item->next;
+    GEN_NAME_(unlink)(lru, item);
+    item->next = lru->reusable;
+    lru->reusable = index;
+    lru->length--;
+    return GEN_IF_VALUE(&item->kv.value, true);
+}
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef MAP_HASH_TYPE
+#undef MAP_INDEX
+
+#include "generic_end.h"
@@ -1,81 +1,306 @@
 #define GEN_PREFIX map
 #define GEN_KV
+#if defined(MAP_INLINE) && !defined(GEN_EQUALS)
+// Keys compared with == can be compared with all inline items at once, including unused ones
+#define MAP_INLINE_ALL
+#endif
+#if defined(MAP_SOA) && defined(GEN_NO_VALUE)
+// Items without values already contain only keys
+#undef MAP_SOA
+#endif
 #include "generic_start.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include "throw.h"
+#ifdef MAP_SNAPSHOT
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 // Additional parameters :
-// MAP_HASH : Hash function for keys (default: the key)
+// MAP_HASH : Hash function for keys, see hash.h for well mixed hash functions (default: the key)
+// MAP_HASH_TYPE : Type of the hashes, must be 64 bits to use more than 2^32 buckets (default: uint32_t)
+// MAP_STORE_HASH : Whether items contain the hash of their key, to compare hashes before keys and grow without hashing again (default: false)
 // MAP_INDEX : Conversion from a hash to an index in a map with a given mask (default: (hash ^ (hash >> 16)) & mask)
+//             MAP_INDEX(hash, mask >> 1) must be equal to MAP_INDEX(hash, mask) & (mask >> 1) if [MAP_INCREMENTAL]
+// MAP_INCREMENTAL : Whether to move items to the new buckets a few at a time after growing instead of all at once (default: false)
+// MAP_MIGRATE : Number of old buckets migrated on each added or removed item if [MAP_INCREMENTAL] (default: 4)
+// MAP_MAX_LOAD : Maximum number of items per bucket before growing, lower uses more memory for shorter linked lists (default: 0.5)
+// MAP_FILTER : Whether to keep a cuckoo filter of the keys, so that most missing keys are not searched in [buckets] and [items]
+//              (a filter with [FILTER_CUCKOO], the same parameters and the same suffix must be included before) (default: false)
+//              (a filter can not contain about 10 keys with the same hash, the filter is disabled until the next growth if they are added)
+//              (not available with [MAP_INCREMENTAL] : the filter is rebuilt from all items when the map grows)
+// MAP_SNAPSHOT : Whether to define [save], [mmap] and [munmap] to store maps of plain data keys and values in files (POSIX only) (default: false)
+// MAP_INLINE : Number of items stored in the map struct itself and searched linearly before allocating buckets (default: none)
+//              (keys compared with the default GEN_EQUALS are compared all at once, with SIMD instructions for small integer keys,
+//              removing an inline item moves the last inline item to its place)
+// MAP_SOA : Whether values are stored in an array parallel to [items], so that searching only reads keys
+//           (iterNext returns a copy of each item, use iterValue to modify values) (default: false)
 
 #ifndef MAP_HASH
 #define MAP_HASH(key) (key)
 #endif
+#ifndef MAP_HASH_TYPE
+#define MAP_HASH_TYPE uint32_t
+#endif
 #ifndef MAP_INDEX
 #define MAP_INDEX(hash, mask) (((hash) ^ (hash >> 16)) & (mask))
 #endif
+#ifndef MAP_MIGRATE
+#define MAP_MIGRATE 4
+#endif
+#ifndef MAP_MAX_LOAD
+#define MAP_MAX_LOAD 0.5
+#endif
+
+#if defined(MAP_FILTER) && defined(MAP_INCREMENTAL)
+#error "MAP_FILTER can not be combined with MAP_INCREMENTAL, rebuilding the filter on growth would pause for all items"
+#endif
+
+#ifdef MAP_FILTER
+#define MAP_FILTER_NAME(name) GEN_NAME_OF(filter, name)
+// Whether a key with a given hash may be in a map
+#define MAP_FILTER_CONTAINS(map, hash) ((map)->unfiltered || MAP_FILTER_NAME(containsHash)(&(map)->filter, hash))
+#endif
+
+// Largest capacity of a map, so that the [MAP_REUSABLE] indices of reusable items can not be confused with used ones
+#define MAP_MAX_CAPACITY ((GEN_SIZE_MAX >> 1) - 1)
+
+// Capacity of a map with a given number of buckets
+#define MAP_CAPACITY(buckets) ((double)(buckets) * (MAP_MAX_LOAD) < (double)MAP_MAX_CAPACITY ? \
+    (GEN_SIZE)((double)(buckets) * (MAP_MAX_LOAD)) : MAP_MAX_CAPACITY)
+
+// Number of keys searched together by batched lookups
+#define MAP_BATCH 16
+
+
+#if defined(MAP_SNAPSHOT) && !defined(MAP_SNAPSHOT_H)
+#define MAP_SNAPSHOT_H
+
+#define MAP_SNAPSHOT_MAGIC "CUTLMAP"
+#define MAP_SNAPSHOT_VERSION 1
+#define MAP_SNAPSHOT_STORE_HASH 1
+#define MAP_SNAPSHOT_SOA 2
+
+// Round up an offset in a snapshot file to the alignment of a type
+#define MAP_SNAPSHOT_ALIGN(offset, type) (((offset) + _Alignof(type) - 1) / _Alignof(type) * _Alignof(type))
+
+/**
+ * @brief Header of a map snapshot file, followed by [end] items, [end] values if [MAP_SOA] and [mask] + 1 buckets
+ * (each array is aligned for its type)
+ * @param magic [MAP_SNAPSHOT_MAGIC]
+ * @param version [MAP_SNAPSHOT_VERSION]
+ * @param sizeSize Size of GEN_SIZE
+ * @param hashSize Size of [MAP_HASH_TYPE]
+ * @param itemSize Size of an item
+ * @param flags [MAP_SNAPSHOT_STORE_HASH] if [MAP_STORE_HASH], [MAP_SNAPSHOT_SOA] if [MAP_SOA]
+ * @param length, mask, reusable, end Fields of the map
+**/
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint16_t sizeSize;
+    uint16_t hashSize;
+    uint32_t itemSize;
+    uint32_t flags;
+    int64_t length;
+    int64_t mask;
+    int64_t reusable;
+    int64_t end;
+    int64_t reserved;
+} _map_snapshotHeader;
+
+#endif
 
 
 /**
  * @brief Map item
- * @param kv Key-value pair
- * @param next Index of the next item in the bucket or index of the next reusable item if the item is reusable
+ * @param kv Key-value pair, or key if [MAP_SOA] (the value is in [values] at the same index)
+ * @param next Index of the next item in the bucket (-1 if last)
+ * or [MAP_REUSABLE] of the index of the next reusable item if the item is reusable (always < -1)
+ * @param hash Hash of the key if [MAP_STORE_HASH]
 **/
 typedef struct {
     GEN_SIZE next;
+#ifdef MAP_STORE_HASH
+    MAP_HASH_TYPE hash;
+#endif
+#ifdef MAP_SOA
+    GEN_KEY key;
+#else
     GEN_KV_TYPE kv;
+#endif
 } GEN_NAME_(item);
 
+// Conversion between the index of the next reusable item and the [next] field of a reusable item
+#define MAP_REUSABLE(next) (-3 - (next))
+
+// Whether an item is in the map (not reusable), [next] + 1 is at most [MAP_MAX_CAPACITY] if it is used and larger otherwise
+#define MAP_USED(item) (GEN_SIZE_SIGNED ? (item)->next >= -1 : (GEN_SIZE)((item)->next + 1) <= MAP_MAX_CAPACITY)
+
+// Key and value of an item of a map, and of its inline item at an index
+#ifdef MAP_SOA
+#define MAP_KEY(item) ((item)->key)
+#define MAP_VALUE(map, item) ((map)->values[(item) - (map)->items])
+#define MAP_INLINE_KEY(map, index) ((map)->inlineKeys[index])
+#define MAP_INLINE_VALUE(map, index) ((map)->inlineValues[index])
+#else
+#define MAP_KEY(item) GEN_KV_KEY((item)->kv)
+#define MAP_VALUE(map, item) ((item)->kv.value)
+#define MAP_INLINE_KEY(map, index) GEN_KV_KEY((map)->inlineItems[index])
+#define MAP_INLINE_VALUE(map, index) ((map)->inlineItems[index].value)
+#endif
+
+// Hash of the key of an item
+#ifdef MAP_STORE_HASH
+#define MAP_ITEM_HASH(item) ((item)->hash)
+#else
+#define MAP_ITEM_HASH(item) ((MAP_HASH_TYPE)MAP_HASH(MAP_KEY(item)))
+#endif
+
+// Whether an item has a key with a given hash
+#ifdef MAP_STORE_HASH
+#define MAP_MATCH(item, key, keyHash) ((item)->hash == (keyHash) && GEN_EQUALS(key, MAP_KEY(item)))
+#else
+#define MAP_MATCH(item, key, keyHash) GEN_EQUALS(key, MAP_KEY(item))
+#endif
+
 
 /**
  * @brief Resizable hash map
  * @param items Items in the map
+ * @param values Values of the items in [items] if [MAP_SOA]
  * @param buckets Linked list of items for each hash value
  * @param length Number of items in the map
- * @param mask Size of [buckets] - 1 = size of [items] * 2 - 1
+ * @param mask Size of [buckets] - 1 (a power of 2 - 1)
+ * @param capacity Size of [items] = [MAP_CAPACITY] of the size of [buckets]
  * @param reusable Index of the first reusable item in [items]
+ * @param end Number of items at the start of [items] that are in the map or reusable
+ * @param filter Hashes of the keys in the map if [MAP_FILTER]
+ * @param unfiltered Whether [filter] is disabled because it could not contain the hashes of the keys if [MAP_FILTER]
+ * @param oldBuckets Buckets before the last growth if [MAP_INCREMENTAL], NULL once all items were migrated
+ * @param oldMask Size of [oldBuckets] - 1 if [MAP_INCREMENTAL]
+ * @param migrated Number of buckets of [oldBuckets] already migrated to [buckets] if [MAP_INCREMENTAL]
+ * A bucket of [buckets] is only initialized once the bucket of [oldBuckets] with the same lower bits is migrated
+ * @param inlineItems Items of the map while it contains at most [MAP_INLINE] items if [MAP_INLINE]
+ * ([items] and [buckets] are NULL and [filter] is not initialized until then)
+ * (split into [inlineKeys] and [inlineValues] if [MAP_SOA])
 **/
 typedef struct {
     GEN_NAME_(item)* items;
+#ifdef MAP_SOA
+    GEN_TYPE* values;
+#endif
     GEN_SIZE* buckets;
     GEN_SIZE length;
     GEN_SIZE mask;
+    GEN_SIZE capacity;
     GEN_SIZE reusable;
+    GEN_SIZE end;
+#ifdef MAP_FILTER
+    GEN_ALGO_OF(filter) filter;
+    bool unfiltered;
+#endif
+#ifdef MAP_INCREMENTAL
+    GEN_SIZE* oldBuckets;
+    GEN_SIZE oldMask;
+    GEN_SIZE migrated;
+#endif
+#if defined(MAP_INLINE) && defined(MAP_SOA)
+    GEN_KEY inlineKeys[MAP_INLINE];
+    GEN_TYPE inlineValues[MAP_INLINE];
+#elif defined(MAP_INLINE)
+    GEN_KV_TYPE inlineItems[MAP_INLINE];
+#endif
 } GEN_ALGO;
 
 
 /**
  * @brief Map iterator
- * @param bucket Bucket index
- * @param index Index of the item
+ * @param index Index of the item in [items]
+ * @param kv Copy of the last returned item if [MAP_SOA]
 **/
 typedef struct {
-    GEN_SIZE bucket;
     GEN_SIZE index;
+#ifdef MAP_SOA
+    GEN_KV_TYPE kv;
+#endif
 } GEN_NAME(iter);
 
 
+/**
+ * @brief Get the number of buckets needed by a map to contain a number of items without growing
+ * @param capacity Number of items
+ * @return Number of buckets (a power of 2)
+**/
+inline GEN_SIZE GEN_NAME_(bucketCount)(GEN_SIZE capacity) {
+    GEN_SIZE buckets = 1;
+    while (MAP_CAPACITY(buckets) < capacity || MAP_CAPACITY(buckets) == 0) {
+        if (buckets > GEN_SIZE_MAX >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)MAP_CAPACITY(buckets));
+        buckets <<= 1;
+    }
+    return buckets;
+}
+
+
 /**
  * @brief Initialize a map
  * @param map The map
- * @param capacity Initial capacity (must be a power of 2)
+ * @param capacity Initial capacity (rounded up so that the number of buckets is a power of 2)
 **/
 inline void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity) {
-    map->items = THROW_PN(malloc(sizeof(GEN_NAME_(item)) * capacity), map->items);
-    map->buckets = THROW_PN(malloc(sizeof(GEN_SIZE) * capacity << 1), map->buckets);
-    memset(map->buckets, -1, sizeof(GEN_SIZE) * capacity << 1);
+#ifdef MAP_INCREMENTAL
+    map->oldBuckets = NULL;
+#endif
+#ifdef MAP_INLINE
+    if (capacity <= MAP_INLINE) {
+        map->items = NULL;
+#ifdef MAP_SOA
+        map->values = NULL;
+#endif
+        map->buckets = NULL;
+        map->length = 0;
+        map->mask = 0;
+        map->capacity = MAP_INLINE;
+        map->reusable = GEN_NONE;
+        map->end = 0;
+        // Unused inline items are still read when comparing all keys at once and when copying the map
+#ifdef MAP_SOA
+        memset(map->inlineKeys, 0, sizeof(map->inlineKeys));
+        memset(map->inlineValues, 0, sizeof(map->inlineValues));
+#else
+        memset(map->inlineItems, 0, sizeof(map->inlineItems));
+#endif
+        return;
+    }
+#endif
+    GEN_SIZE buckets = GEN_NAME_(bucketCount)(capacity);
+    map->capacity = MAP_CAPACITY(buckets);
+    map->items = THROW_PN(malloc(sizeof(GEN_NAME_(item)) * map->capacity), map->items);
+#ifdef MAP_SOA
+    map->values = THROW_PN(malloc(sizeof(GEN_TYPE) * map->capacity), map->values);
+#endif
+    map->buckets = THROW_PN(malloc(sizeof(GEN_SIZE) * buckets), map->buckets);
+    memset(map->buckets, -1, sizeof(GEN_SIZE) * buckets);
     map->length = 0;
-    map->mask = (capacity << 1) - 1;
-    map->reusable = -1;
+    map->mask = buckets - 1;
+    map->reusable = GEN_NONE;
+    map->end = 0;
+#ifdef MAP_FILTER
+    MAP_FILTER_NAME(init)(&map->filter, map->capacity);
+    map->unfiltered = false;
+#endif
 }
 
 
 /**
  * @brief Create a map
- * @param capacity Initial capacity (must be a power of 2)
+ * @param capacity Initial capacity (rounded up so that the number of buckets is a power of 2)
  * @return The map
 **/
 inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
@@ -85,13 +310,39 @@ inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
 }
 
 
+/**
+ * @brief Create a map containing the keys (and values) of arrays, with the items of each bucket next to each other
+ * (the keys must be distinct)
+ * @param keys Keys of the items
+ * @param values Values of the items
+ * @param n Number of items
+ * @return The map
+**/
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_SIZE n);
+#else
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n);
+#endif
+
+
 /**
  * @brief Free a map
  * @param map The map
 **/
 inline void GEN_NAME(free)(GEN_ALGO* map) {
+#if defined(MAP_FILTER) && defined(MAP_INLINE)
+    if (map->buckets != NULL) MAP_FILTER_NAME(free)(&map->filter);
+#elif defined(MAP_FILTER)
+    MAP_FILTER_NAME(free)(&map->filter);
+#endif
     free(map->items);
+#ifdef MAP_SOA
+    free(map->values);
+#endif
     free(map->buckets);
+#ifdef MAP_INCREMENTAL
+    free(map->oldBuckets);
+#endif
 }
 
 
@@ -199,6 +450,28 @@ inline bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
 #endif
 
 
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Get multiple items in a map, overlapping the memory accesses of the lookups
+ * @param map The map
+ * @param keys Keys of the items
+ * @param n Number of keys
+ * @param refs Pointer to the value of each item (usable until next added item), NULL if not found
+**/
+void GEN_NAME(refBatch)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE n, GEN_TYPE** refs);
+#endif
+
+
+/**
+ * @brief Check whether a map contains multiple keys, overlapping the memory accesses of the lookups
+ * @param map The map
+ * @param keys The keys
+ * @param n Number of keys
+ * @param found Whether each key was found
+**/
+void GEN_NAME(containsBatch)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE n, bool* found);
+
+
 #ifndef GEN_NO_VALUE
 /**
  * @brief Add an item with no value in a map (undefined if it already exists)
@@ -252,40 +525,167 @@ inline bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
 GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key);
 
 
+/**
+ * @brief Move all items to the start of [items] and rebuild the buckets,
+ * so that iterating takes a time proportional to the number of items (invalidates pointers to items)
+ * @param map The map
+**/
+void GEN_NAME(compact)(GEN_ALGO* map);
+
+
+/**
+ * @brief Grow a map so that it can contain at least [capacity] items without growing again (invalidates pointers to items)
+ * @param map The map
+ * @param capacity Number of items
+**/
+void GEN_NAME(reserve)(GEN_ALGO* map, GEN_SIZE capacity);
+
+
+/**
+ * @brief Compact a map and reduce its capacity to the smallest one that can contain its items (invalidates pointers to items)
+ * @param map The map
+**/
+void GEN_NAME(shrinkToFit)(GEN_ALGO* map);
+
+
+#ifdef GEN_NO_VALUE
+/**
+ * @brief Create a set containing the keys that are in either of two sets
+ * (the keys of the smaller set are searched in the larger one in batches)
+ * @param a First set
+ * @param b Second set
+ * @return The union
+**/
+GEN_ALGO GEN_NAME(union)(GEN_ALGO* a, GEN_ALGO* b);
+
+
+/**
+ * @brief Create a set containing the keys that are in both of two sets
+ * (the keys of the smaller set are searched in the larger one in batches)
+ * @param a First set
+ * @param b Second set
+ * @return The intersection
+**/
+GEN_ALGO GEN_NAME(intersect)(GEN_ALGO* a, GEN_ALGO* b);
+
+
+/**
+ * @brief Create a set containing the keys of a set that are not in another set
+ * (the keys of [a] are searched in [b] in batches if [a] is smaller, otherwise the keys of [b] are removed from a copy of [a])
+ * @param a The set
+ * @param b Keys to exclude
+ * @return The difference
+**/
+GEN_ALGO GEN_NAME(difference)(GEN_ALGO* a, GEN_ALGO* b);
+
+
+/**
+ * @brief Check whether all keys of a set are in another set (the keys are searched in batches)
+ * @param a The set
+ * @param b The other set
+ * @return Whether [a] is a subset of [b]
+**/
+bool GEN_NAME(isSubset)(GEN_ALGO* a, GEN_ALGO* b);
+#endif
+
+
+#ifdef MAP_SNAPSHOT
+/**
+ * @brief Write a map at the current position of a file, with the items and buckets as they are in memory
+ * (keys and values must not contain pointers, the file can only be read on the same architecture,
+ * inline items are saved from a copy of the map moved to buckets if [MAP_INLINE], so the map itself is unchanged)
+ * @param map The map
+ * @param fd The file
+**/
+void GEN_NAME(save)(GEN_ALGO* map, int fd);
+
+
+/**
+ * @brief Map a file written by [save] (at the start of the file) to memory without copying or rehashing its items
+ * (the map is read-only : it can only be used with [ref], [get], [contains], the batch functions and iteration,
+ * and must be released with [munmap] instead of [free])
+ * @param path Path of the file
+ * @return The map
+**/
+GEN_ALGO GEN_NAME(mmap)(const char* path);
+
+
+/**
+ * @brief Unmap a map created by [mmap]
+ * @param map The map
+**/
+void GEN_NAME(munmap)(GEN_ALGO* map);
+#endif
+
+
 /**
  * @brief Start iterating on a map
  * @return The iterator
 **/
 inline GEN_NAME(iter) GEN_NAME(iterStart)(void) {
-    return (GEN_NAME(iter)) { .bucket = -1, .index = -1 };
+    return (GEN_NAME(iter)) { .index = GEN_NONE };
 }
 
 
 /**
- * @brief Get the next item while iterating on a map
+ * @brief Get the next item while iterating on a map, in the order of [items]
  * @param map The map
  * @param iter The iterator
- * @return Next item, NULL if no more items
+ * @return Next item (copy of the item stored in the iterator if [MAP_SOA]), NULL if no more items
 **/
 inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
-    while (iter->index == -1) {
-        iter->bucket++;
-        if (iter->bucket > map->mask) return NULL;
-        iter->index = map->buckets[iter->bucket];
+#if defined(MAP_INLINE) && defined(MAP_SOA)
+    if (map->buckets == NULL) {
+        if ((GEN_SIZE)(iter->index + 1) >= map->length) return NULL;
+        iter->index++;
+        iter->kv.key = MAP_INLINE_KEY(map, iter->index);
+        iter->kv.value = MAP_INLINE_VALUE(map, iter->index);
+        return &iter->kv;
+    }
+#elif defined(MAP_INLINE)
+    if (map->buckets == NULL) return (GEN_SIZE)(iter->index + 1) < map->length ? map->inlineItems + ++iter->index : NULL;
+#endif
+    while ((GEN_SIZE)(iter->index + 1) < map->end) {
+        GEN_NAME_(item)* item = map->items + ++iter->index;
+        if (MAP_USED(item)) {
+#ifdef MAP_SOA
+            iter->kv.key = item->key;
+            iter->kv.value = MAP_VALUE(map, item);
+            return &iter->kv;
+#else
+            return &item->kv;
+#endif
+        }
     }
-    GEN_NAME_(item)* item = map->items + iter->index;
-    iter->index = item->next;
-    return &item->kv;
+    return NULL;
+}
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Get the value of the last item returned by [iterNext]
+ * @param map The map
+ * @param iter The iterator
+ * @return Pointer to the value of the item in the map (usable until next added item)
+**/
+inline GEN_TYPE* GEN_NAME(iterValue)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) return &MAP_INLINE_VALUE(map, iter->index);
+#endif
+    return &MAP_VALUE(map, map->items + iter->index);
 }
+#endif
 
 
 #ifdef GEN_SOURCE
 
 
+GEN_SIZE GEN_NAME_(bucketCount)(GEN_SIZE capacity);
 void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity);
 GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
 void GEN_NAME(free)(GEN_ALGO* map);
 #ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added);
 GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key);
 GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
 void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
@@ -296,55 +696,150 @@ bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
 #endif
 GEN_NAME(iter) GEN_NAME(iterStart)();
 GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(iterValue)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+#endif
 
 
-static void GEN_NAME_(grow)(GEN_ALGO* map) {
-    GEN_SIZE oldCapacity = map->mask + 1;
-    GEN_SIZE capacity = oldCapacity << 1;
-    map->mask = capacity - 1;
-    map->items = THROW_PN(realloc(map->items, sizeof(GEN_NAME_(item)) * oldCapacity), map->items);
-    GEN_SIZE* newBuckets = THROW_PN(malloc(sizeof(GEN_SIZE) * capacity), newBuckets);
-    memset(newBuckets, -1, sizeof(GEN_SIZE) * capacity);
-    for (GEN_SIZE i = 0; i < oldCapacity; i++) { // Rebuild linked lists in newBuckets
-        GEN_SIZE index = map->buckets[i];
-        while (index != -1) {
-            GEN_NAME_(item)* item = map->items + index;
-            GEN_SIZE newBucket = MAP_INDEX(MAP_HASH(GEN_KV_KEY(item->kv)), map->mask);
-            if (newBuckets[newBucket] == -1) newBuckets[newBucket] = index;
-            else { // Add at the end
-                GEN_NAME_(item)* prevItem = map->items + newBuckets[newBucket];
-                while (prevItem->next != -1) prevItem = map->items + prevItem->next;
-                prevItem->next = index;
-            }
-            index = item->next;
-            item->next = -1;
+// Move a linked list of items to their buckets
+static void GEN_NAME_(relinkList)(GEN_ALGO* map, GEN_SIZE index) {
+    while (index != GEN_NONE) {
+        GEN_NAME_(item)* item = map->items + index;
+        MAP_HASH_TYPE hash = MAP_ITEM_HASH(item);
+        GEN_SIZE* newBucket = map->buckets + MAP_INDEX(hash, map->mask);
+        GEN_SIZE next = item->next;
+        item->next = *newBucket;
+        *newBucket = index;
+        index = next;
+    }
+}
+
+
+#ifdef MAP_INCREMENTAL
+
+// Move the items of a bucket of the previous buckets to the 2 corresponding new buckets
+static void GEN_NAME_(migrateBucket)(GEN_ALGO* map, GEN_SIZE* oldBuckets, GEN_SIZE oldBucket) {
+    map->buckets[oldBucket] = GEN_NONE;
+    map->buckets[oldBucket + (map->mask >> 1) + 1] = GEN_NONE;
+    GEN_NAME_(relinkList)(map, oldBuckets[oldBucket]);
+}
+
+
+// Migrate up to n buckets of the previous buckets
+static void GEN_NAME_(migrate)(GEN_ALGO* map, GEN_SIZE n) {
+    if (map->oldBuckets == NULL) return;
+    while (n-- > 0 && map->migrated <= map->oldMask) {
+        GEN_NAME_(migrateBucket)(map, map->oldBuckets, map->migrated++);
+    }
+    if (map->migrated > map->oldMask) {
+        free(map->oldBuckets);
+        map->oldBuckets = NULL;
+    }
+}
+
+#endif
+
+
+#ifdef MAP_FILTER
+
+// Rebuild the filter of a map with a given capacity, or twice that capacity if it is full,
+// disable it if it is still full (a larger filter does not help if too many keys have the same hash)
+static void GEN_NAME_(refilter)(GEN_ALGO* map, GEN_SIZE capacity) {
+    for (int retry = 0; retry < 2; retry++, capacity <<= 1) {
+        MAP_FILTER_NAME(free)(&map->filter);
+        MAP_FILTER_NAME(init)(&map->filter, capacity);
+        GEN_SIZE i = 0;
+        while (i < map->end && (!MAP_USED(map->items + i) || MAP_FILTER_NAME(addHash)(&map->filter, MAP_ITEM_HASH(map->items + i)))) i++;
+        if (i == map->end) {
+            map->unfiltered = false;
+            return;
         }
     }
-    free(map->buckets);
-    map->buckets = newBuckets;
+    MAP_FILTER_NAME(free)(&map->filter);
+    MAP_FILTER_NAME(init)(&map->filter, 0);
+    map->unfiltered = true;
+}
+
+
+// Add the hash of an item already in a map to its filter
+static inline void GEN_NAME_(filterAdd)(GEN_ALGO* map, MAP_HASH_TYPE hash) {
+    if (!map->unfiltered && !MAP_FILTER_NAME(addHash)(&map->filter, hash)) GEN_NAME_(refilter)(map, map->capacity << 1);
+}
+
+#endif
+
+
+static void GEN_NAME_(grow)(GEN_ALGO* map) {
+#ifdef MAP_INCREMENTAL
+    GEN_NAME_(migrate)(map, map->mask + 1);
+#endif
+    GEN_SIZE oldBucketCount = map->mask + 1;
+    if (oldBucketCount > GEN_SIZE_MAX >> 1 || MAP_CAPACITY(oldBucketCount << 1) <= map->capacity) {
+        THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)map->capacity);
+    }
+    GEN_SIZE bucketCount = oldBucketCount << 1;
+    GEN_SIZE* oldBuckets = map->buckets;
+    map->mask = bucketCount - 1;
+    map->capacity = MAP_CAPACITY(bucketCount);
+    map->items = THROW_PN(realloc(map->items, sizeof(GEN_NAME_(item)) * map->capacity), map->items);
+#ifdef MAP_SOA
+    map->values = THROW_PN(realloc(map->values, sizeof(GEN_TYPE) * map->capacity), map->values);
+#endif
+    map->buckets = THROW_PN(malloc(sizeof(GEN_SIZE) * bucketCount), map->buckets);
+#ifdef MAP_INCREMENTAL
+    map->oldBuckets = oldBuckets;
+    map->oldMask = oldBucketCount - 1;
+    map->migrated = 0;
+#else
+    memset(map->buckets, -1, sizeof(GEN_SIZE) * bucketCount);
+    for (GEN_SIZE i = 0; i < oldBucketCount; i++) GEN_NAME_(relinkList)(map, oldBuckets[i]);
+    free(oldBuckets);
+#endif
+#ifdef MAP_FILTER
+    GEN_NAME_(refilter)(map, map->capacity);
+#endif
+}
+
+
+// Linked list of items that may contain a key with a given hash
+static inline GEN_SIZE* GEN_NAME_(bucket)(GEN_ALGO* map, MAP_HASH_TYPE hash) {
+    GEN_SIZE bucket = MAP_INDEX(hash, map->mask);
+#ifdef MAP_INCREMENTAL
+    if (map->oldBuckets != NULL && (bucket & map->oldMask) >= map->migrated) {
+        return map->oldBuckets + (bucket & map->oldMask);
+    }
+#endif
+    return map->buckets + bucket;
 }
 
 
-static GEN_NAME_(item)* GEN_NAME_(addItem)(GEN_ALGO* map, GEN_SIZE bucket) {
+static GEN_NAME_(item)* GEN_NAME_(addItem)(GEN_ALGO* map, GEN_SIZE* bucket, GEN_KEY key, MAP_HASH_TYPE hash) {
     GEN_SIZE i;
-    if (map->reusable != -1) {
+    if (map->reusable != GEN_NONE) {
         i = map->reusable;
-        map->reusable = map->items[i].next;
+        map->reusable = MAP_REUSABLE(map->items[i].next);
     }
-    else i = map->length;
+    else i = map->end++;
     map->length++;
     GEN_NAME_(item)* item = map->items + i;
-    item->next = map->buckets[bucket];
-    map->buckets[bucket] = i;
+    item->next = *bucket;
+#ifdef MAP_STORE_HASH
+    item->hash = hash;
+#endif
+    MAP_KEY(item) = key;
+    *bucket = i;
+#ifdef MAP_FILTER
+    GEN_NAME_(filterAdd)(map, hash);
+#endif
     return item;
 }
 
 
-static GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME_(search)(GEN_ALGO* map, GEN_SIZE index, GEN_KEY key) {
-    while (index != -1) { // Search in linked list
+static GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME_(search)(GEN_ALGO* map, GEN_SIZE index, GEN_KEY key, MAP_HASH_TYPE hash) {
+    while (index != GEN_NONE) { // Search in linked list
         GEN_NAME_(item)* item = map->items + index;
-        if (GEN_EQUALS(key, GEN_KV_KEY(item->kv))) {
-            return GEN_IF_VALUE(&item->kv.value, true);
+        if (MAP_MATCH(item, key, hash)) {
+            return GEN_IF_VALUE(&MAP_VALUE(map, item), true);
         }
         index = item->next;
     }
@@ -352,13 +847,84 @@ static GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME_(search)(GEN_ALGO* map, GEN_SIZE i
 }
 
 
+#ifdef MAP_INLINE
+
+// Index of the inline item with a key, -1 if not found
+static inline GEN_SIZE GEN_NAME_(inlineSearch)(GEN_ALGO* map, GEN_KEY key) {
+#ifdef MAP_INLINE_ALL
+    // Compare all items without branches so that the loop can be vectorized (the keys are distinct)
+    GEN_SIZE index = 0, length = map->length;
+    for (GEN_SIZE i = 0; i < MAP_INLINE; i++) {
+        index |= -(GEN_SIZE)(GEN_EQUALS(key, MAP_INLINE_KEY(map, i)) & (i < length)) & (i + 1);
+    }
+    return index - 1;
+#else
+    for (GEN_SIZE i = 0; i < map->length; i++) {
+        if (GEN_EQUALS(key, MAP_INLINE_KEY(map, i))) return i;
+    }
+    return GEN_NONE;
+#endif
+}
+
+
+// Move the inline items of a map to buckets, with at least a given capacity
+static void GEN_NAME_(spill)(GEN_ALGO* map, GEN_SIZE capacity) {
+#ifdef MAP_SOA
+    GEN_KEY keys[MAP_INLINE];
+    GEN_TYPE values[MAP_INLINE];
+    GEN_SIZE length = map->length;
+    memcpy(keys, map->inlineKeys, sizeof(GEN_KEY) * length);
+    memcpy(values, map->inlineValues, sizeof(GEN_TYPE) * length);
+    GEN_NAME(init)(map, capacity > MAP_INLINE ? capacity : MAP_INLINE + 1);
+    for (GEN_SIZE i = 0; i < length; i++) {
+        MAP_HASH_TYPE hash = MAP_HASH(keys[i]);
+        GEN_NAME_(item)* item = GEN_NAME_(addItem)(map, GEN_NAME_(bucket)(map, hash), keys[i], hash);
+        MAP_VALUE(map, item) = values[i];
+    }
+#else
+    GEN_KV_TYPE items[MAP_INLINE];
+    GEN_SIZE length = map->length;
+    memcpy(items, map->inlineItems, sizeof(GEN_KV_TYPE) * length);
+    GEN_NAME(init)(map, capacity > MAP_INLINE ? capacity : MAP_INLINE + 1);
+    for (GEN_SIZE i = 0; i < length; i++) {
+        MAP_HASH_TYPE hash = MAP_HASH(GEN_KV_KEY(items[i]));
+        GEN_NAME_(addItem)(map, GEN_NAME_(bucket)(map, hash), GEN_KV_KEY(items[i]), hash)->kv = items[i];
+    }
+#endif
+}
+
+
+// Add an item in the inline items of a map and return its index, or move them to buckets if they are full and return -1
+static GEN_SIZE GEN_NAME_(inlineAdd)(GEN_ALGO* map, GEN_KEY key) {
+    if (map->length == MAP_INLINE) {
+        GEN_NAME_(spill)(map, MAP_INLINE << 1);
+        return GEN_NONE;
+    }
+    GEN_SIZE index = map->length++;
+    map->end = map->length;
+    MAP_INLINE_KEY(map, index) = key;
+    return index;
+}
+
+#endif
+
+
 #ifdef GEN_NO_VALUE
 bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
 #else
 GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key) {
 #endif
-    GEN_SIZE index = map->buckets[MAP_INDEX(MAP_HASH(key), map->mask)];
-    return GEN_NAME_(search)(map, index, key);
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        GEN_SIZE index = GEN_NAME_(inlineSearch)(map, key);
+        return index == GEN_NONE ? 0 : GEN_IF_VALUE(&MAP_INLINE_VALUE(map, index), true);
+    }
+#endif
+    MAP_HASH_TYPE hash = MAP_HASH(key);
+#ifdef MAP_FILTER
+    if (!MAP_FILTER_CONTAINS(map, hash)) return 0;
+#endif
+    return GEN_NAME_(search)(map, *GEN_NAME_(bucket)(map, hash), key, hash);
 }
 
 
@@ -367,9 +933,32 @@ bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key) {
 #else
 GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added) {
 #endif
-    if (map->length >= map->mask >> 1) GEN_NAME_(grow)(map);
-    GEN_SIZE bucket = MAP_INDEX(MAP_HASH(key), map->mask);
-    GEN_IF_VALUE(GEN_TYPE*, bool) found = GEN_NAME_(search)(map, map->buckets[bucket], key);
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        GEN_SIZE index = GEN_NAME_(inlineSearch)(map, key);
+#ifdef GEN_NO_VALUE
+        if (index != GEN_NONE) return false;
+        if (GEN_NAME_(inlineAdd)(map, key) != GEN_NONE) return true;
+#else
+        if (added) *added = index == GEN_NONE;
+        if (index != GEN_NONE) return &MAP_INLINE_VALUE(map, index);
+        index = GEN_NAME_(inlineAdd)(map, key);
+        if (index != GEN_NONE) return &MAP_INLINE_VALUE(map, index);
+#endif
+    }
+#endif
+    if (map->length >= map->capacity) GEN_NAME_(grow)(map);
+#ifdef MAP_INCREMENTAL
+    else GEN_NAME_(migrate)(map, MAP_MIGRATE);
+#endif
+    MAP_HASH_TYPE hash = MAP_HASH(key);
+    GEN_SIZE* bucket = GEN_NAME_(bucket)(map, hash);
+#ifdef MAP_FILTER
+    GEN_IF_VALUE(GEN_TYPE*, bool) found = 0;
+    if (MAP_FILTER_CONTAINS(map, hash)) found = GEN_NAME_(search)(map, *bucket, key, hash);
+#else
+    GEN_IF_VALUE(GEN_TYPE*, bool) found = GEN_NAME_(search)(map, *bucket, key, hash);
+#endif
     if (found) {
 #ifdef GEN_NO_VALUE
         return false;
@@ -378,14 +967,74 @@ GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added) {
         return found;
 #endif
     }
-    GEN_NAME_(item)* item = GEN_NAME_(addItem)(map, bucket);
-    GEN_KV_KEY(item->kv) = key;
 #ifdef GEN_NO_VALUE
+    GEN_NAME_(addItem)(map, bucket, key, hash);
     return true;
 #else
     if (added) *added = true;
-    return &item->kv.value;
+    GEN_NAME_(item)* item = GEN_NAME_(addItem)(map, bucket, key, hash);
+    return &MAP_VALUE(map, item);
+#endif
+}
+
+
+// Search up to [MAP_BATCH] keys, prefetching all buckets then all first items before comparing keys
+static inline void GEN_NAME_(searchBatch)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE n, GEN_IF_VALUE(GEN_TYPE*, bool)* found) {
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        for (GEN_SIZE i = 0; i < n; i++) {
+            GEN_SIZE index = GEN_NAME_(inlineSearch)(map, keys[i]);
+            found[i] = index == GEN_NONE ? 0 : GEN_IF_VALUE(&MAP_INLINE_VALUE(map, index), true);
+        }
+        return;
+    }
+#endif
+    MAP_HASH_TYPE hashes[MAP_BATCH];
+    GEN_SIZE* buckets[MAP_BATCH];
+    GEN_SIZE indices[MAP_BATCH];
+    for (GEN_SIZE i = 0; i < n; i++) {
+        hashes[i] = MAP_HASH(keys[i]);
+#ifdef MAP_FILTER
+        if (!MAP_FILTER_CONTAINS(map, hashes[i])) {
+            buckets[i] = NULL;
+            continue;
+        }
+#endif
+        buckets[i] = GEN_NAME_(bucket)(map, hashes[i]);
+        __builtin_prefetch(buckets[i]);
+    }
+    for (GEN_SIZE i = 0; i < n; i++) {
+#ifdef MAP_FILTER
+        if (buckets[i] == NULL) {
+            indices[i] = GEN_NONE;
+            continue;
+        }
+#endif
+        indices[i] = *buckets[i];
+        if (indices[i] != GEN_NONE) __builtin_prefetch(map->items + indices[i]);
+    }
+    for (GEN_SIZE i = 0; i < n; i++) {
+        found[i] = GEN_NAME_(search)(map, indices[i], keys[i], hashes[i]);
+    }
+}
+
+
+#ifndef GEN_NO_VALUE
+void GEN_NAME(refBatch)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE n, GEN_TYPE** refs) {
+    for (GEN_SIZE i = 0; i < n; i += MAP_BATCH) {
+        GEN_NAME_(searchBatch)(map, keys + i, n - i < MAP_BATCH ? n - i : MAP_BATCH, refs + i);
+    }
+}
 #endif
+
+
+void GEN_NAME(containsBatch)(GEN_ALGO* map, GEN_KEY* keys, GEN_SIZE n, bool* found) {
+    GEN_IF_VALUE(GEN_TYPE*, bool) batch[MAP_BATCH];
+    for (GEN_SIZE i = 0; i < n; i += MAP_BATCH) {
+        GEN_SIZE count = n - i < MAP_BATCH ? n - i : MAP_BATCH;
+        GEN_NAME_(searchBatch)(map, keys + i, count, batch);
+        for (GEN_SIZE j = 0; j < count; j++) found[i + j] = batch[j];
+    }
 }
 
 
@@ -394,28 +1043,453 @@ void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key) {
 #else
 GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key) {
 #endif
-    if (map->length >= map->mask >> 1) GEN_NAME_(grow)(map);
-    GEN_SIZE bucket = MAP_INDEX(MAP_HASH(key), map->mask);
-    GEN_NAME_(item)* item = GEN_NAME_(addItem)(map, bucket);
-    GEN_KV_KEY(item->kv) = key;
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        GEN_SIZE index = GEN_NAME_(inlineAdd)(map, key);
+#ifdef GEN_NO_VALUE
+        if (index != GEN_NONE) return;
+#else
+        if (index != GEN_NONE) return &MAP_INLINE_VALUE(map, index);
+#endif
+    }
+#endif
+    if (map->length >= map->capacity) GEN_NAME_(grow)(map);
+#ifdef MAP_INCREMENTAL
+    else GEN_NAME_(migrate)(map, MAP_MIGRATE);
+#endif
+    MAP_HASH_TYPE hash = MAP_HASH(key);
+#ifdef GEN_NO_VALUE
+    GEN_NAME_(addItem)(map, GEN_NAME_(bucket)(map, hash), key, hash);
+#else
+    GEN_NAME_(item)* item = GEN_NAME_(addItem)(map, GEN_NAME_(bucket)(map, hash), key, hash);
+    return &MAP_VALUE(map, item);
+#endif
+}
+
+
+#ifdef GEN_NO_VALUE
+
+// Add to a set the keys of another set, only those that are found (or not found) in a third set if it is not NULL
+static void GEN_NAME_(addKeys)(GEN_ALGO* result, GEN_ALGO* keys, GEN_ALGO* other, bool found) {
+    GEN_KEY batch[MAP_BATCH];
+    bool batchFound[MAP_BATCH];
+    GEN_SIZE count = 0;
+    GEN_NAME(iter) iter = GEN_NAME(iterStart)();
+    GEN_KEY* key;
+    do {
+        key = GEN_NAME(iterNext)(keys, &iter);
+        if (key) batch[count++] = *key;
+        if (count == MAP_BATCH || (!key && count > 0)) {
+            if (other) GEN_NAME_(searchBatch)(other, batch, count, batchFound);
+            for (GEN_SIZE i = 0; i < count; i++) {
+                if (!other || batchFound[i] == found) GEN_NAME(add)(result, batch[i]);
+            }
+            count = 0;
+        }
+    } while (key);
+}
+
+
+GEN_ALGO GEN_NAME(union)(GEN_ALGO* a, GEN_ALGO* b) {
+    GEN_ALGO* larger = a->length >= b->length ? a : b;
+    GEN_ALGO* smaller = larger == a ? b : a;
+    GEN_ALGO result;
+    GEN_NAME(init)(&result, a->length + b->length);
+    GEN_NAME_(addKeys)(&result, larger, NULL, false);
+    GEN_NAME_(addKeys)(&result, smaller, larger, false);
+    return result;
+}
+
+
+GEN_ALGO GEN_NAME(intersect)(GEN_ALGO* a, GEN_ALGO* b) {
+    GEN_ALGO* larger = a->length >= b->length ? a : b;
+    GEN_ALGO* smaller = larger == a ? b : a;
+    GEN_ALGO result;
+    GEN_NAME(init)(&result, smaller->length);
+    GEN_NAME_(addKeys)(&result, smaller, larger, true);
+    return result;
+}
+
+
+GEN_ALGO GEN_NAME(difference)(GEN_ALGO* a, GEN_ALGO* b) {
+    GEN_ALGO result;
+    GEN_NAME(init)(&result, a->length);
+    if (a->length <= b->length) {
+        GEN_NAME_(addKeys)(&result, a, b, false);
+        return result;
+    }
+    GEN_NAME_(addKeys)(&result, a, NULL, false);
+    GEN_NAME(iter) iter = GEN_NAME(iterStart)();
+    GEN_KEY* key;
+    while ((key = GEN_NAME(iterNext)(b, &iter))) GEN_NAME(remove)(&result, *key);
+    return result;
+}
+
+
+bool GEN_NAME(isSubset)(GEN_ALGO* a, GEN_ALGO* b) {
+    if (a->length > b->length) return false;
+    GEN_KEY batch[MAP_BATCH];
+    bool batchFound[MAP_BATCH];
+    GEN_SIZE count = 0;
+    GEN_NAME(iter) iter = GEN_NAME(iterStart)();
+    GEN_KEY* key;
+    do {
+        key = GEN_NAME(iterNext)(a, &iter);
+        if (key) batch[count++] = *key;
+        if (count == MAP_BATCH || (!key && count > 0)) {
+            GEN_NAME_(searchBatch)(b, batch, count, batchFound);
+            for (GEN_SIZE i = 0; i < count; i++) {
+                if (!batchFound[i]) return false;
+            }
+            count = 0;
+        }
+    } while (key);
+    return true;
+}
+
+#endif
+
+
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_SIZE n) {
+#else
+GEN_ALGO GEN_NAME(fromArrays)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n) {
+#endif
+    GEN_ALGO map;
+    GEN_NAME(init)(&map, n);
+#ifdef MAP_INLINE
+    if (map.buckets == NULL) {
+        for (GEN_SIZE i = 0; i < n; i++) {
+            MAP_INLINE_KEY(&map, i) = keys[i];
 #ifndef GEN_NO_VALUE
-    return &item->kv.value;
+            MAP_INLINE_VALUE(&map, i) = values[i];
+#endif
+        }
+        map.length = n;
+        map.end = n;
+        return map;
+    }
 #endif
+    THROW_PN(MAP_HASH_TYPE* hashes = malloc(sizeof(MAP_HASH_TYPE) * (n + 1)), hashes);
+    for (GEN_SIZE i = 0; i < n; i++) hashes[i] = MAP_HASH(keys[i]);
+
+    // Counting sort of the items by bucket, [buckets] contains the end of each bucket after sorting
+    memset(map.buckets, 0, sizeof(GEN_SIZE) * (map.mask + 1));
+    for (GEN_SIZE i = 0; i < n; i++) map.buckets[MAP_INDEX(hashes[i], map.mask)]++;
+    GEN_SIZE start = 0;
+    for (GEN_SIZE i = 0; i <= map.mask; i++) {
+        GEN_SIZE count = map.buckets[i];
+        map.buckets[i] = start;
+        start += count;
+    }
+    for (GEN_SIZE i = 0; i < n; i++) {
+        GEN_NAME_(item)* item = map.items + map.buckets[MAP_INDEX(hashes[i], map.mask)]++;
+#ifdef MAP_STORE_HASH
+        item->hash = hashes[i];
+#endif
+        MAP_KEY(item) = keys[i];
+#ifndef GEN_NO_VALUE
+        MAP_VALUE(&map, item) = values[i];
+#endif
+    }
+    free(hashes);
+
+    // Link the items of each bucket, from the last bucket so that the end of the previous bucket is still available
+    for (GEN_SIZE i = map.mask + 1; i-- > 0;) {
+        GEN_SIZE end = map.buckets[i];
+        GEN_SIZE begin = i == 0 ? 0 : map.buckets[i - 1];
+        for (GEN_SIZE j = begin; j < end; j++) map.items[j].next = j + 1 < end ? j + 1 : GEN_NONE;
+        map.buckets[i] = begin < end ? begin : GEN_NONE;
+    }
+    map.length = n;
+    map.end = n;
+#ifdef MAP_FILTER
+    GEN_NAME_(refilter)(&map, map.capacity);
+#endif
+    return map;
+}
+
+
+// Link all items in [items] to buckets, replacing the previous buckets
+static void GEN_NAME_(relink)(GEN_ALGO* map) {
+#ifdef MAP_INCREMENTAL
+    free(map->oldBuckets);
+    map->oldBuckets = NULL;
+#endif
+    memset(map->buckets, -1, sizeof(GEN_SIZE) * (map->mask + 1));
+    for (GEN_SIZE i = 0; i < map->end; i++) {
+        GEN_NAME_(item)* item = map->items + i;
+        if (!MAP_USED(item)) continue;
+        GEN_SIZE* bucket = map->buckets + MAP_INDEX(MAP_ITEM_HASH(item), map->mask);
+        item->next = *bucket;
+        *bucket = i;
+    }
+}
+
+
+// Change the number of buckets of a map (the items must fit in the new capacity)
+static void GEN_NAME_(resize)(GEN_ALGO* map, GEN_SIZE bucketCount) {
+    map->mask = bucketCount - 1;
+    map->capacity = MAP_CAPACITY(bucketCount);
+    map->items = THROW_PN(realloc(map->items, sizeof(GEN_NAME_(item)) * map->capacity), map->items);
+#ifdef MAP_SOA
+    map->values = THROW_PN(realloc(map->values, sizeof(GEN_TYPE) * map->capacity), map->values);
+#endif
+    free(map->buckets);
+    map->buckets = THROW_PN(malloc(sizeof(GEN_SIZE) * bucketCount), map->buckets);
+    GEN_NAME_(relink)(map);
+#ifdef MAP_FILTER
+    GEN_NAME_(refilter)(map, map->capacity);
+#endif
+}
+
+
+void GEN_NAME(compact)(GEN_ALGO* map) {
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) return;
+#endif
+    GEN_SIZE length = 0;
+    for (GEN_SIZE i = 0; i < map->end; i++) {
+        if (!MAP_USED(map->items + i)) continue;
+#ifdef MAP_SOA
+        map->values[length] = map->values[i];
+#endif
+        map->items[length++] = map->items[i];
+    }
+    map->end = length;
+    map->reusable = GEN_NONE;
+    GEN_NAME_(relink)(map);
 }
 
 
+void GEN_NAME(reserve)(GEN_ALGO* map, GEN_SIZE capacity) {
+    if (capacity <= map->capacity) return;
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        GEN_NAME_(spill)(map, capacity);
+        return;
+    }
+#endif
+    GEN_NAME_(resize)(map, GEN_NAME_(bucketCount)(capacity));
+}
+
+
+void GEN_NAME(shrinkToFit)(GEN_ALGO* map) {
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) return;
+    if (map->length <= MAP_INLINE) {
+        // Move the items back in the map struct
+        GEN_KEY keys[MAP_INLINE];
+#ifndef GEN_NO_VALUE
+        GEN_TYPE values[MAP_INLINE];
+#endif
+        GEN_SIZE length = 0;
+        for (GEN_SIZE i = 0; i < map->end; i++) {
+            GEN_NAME_(item)* item = map->items + i;
+            if (!MAP_USED(item)) continue;
+            keys[length] = MAP_KEY(item);
+#ifndef GEN_NO_VALUE
+            values[length] = MAP_VALUE(map, item);
+#endif
+            length++;
+        }
+        GEN_NAME(free)(map);
+        GEN_NAME(init)(map, 0);
+        for (GEN_SIZE i = 0; i < length; i++) {
+            MAP_INLINE_KEY(map, i) = keys[i];
+#ifndef GEN_NO_VALUE
+            MAP_INLINE_VALUE(map, i) = values[i];
+#endif
+        }
+        map->length = length;
+        map->end = length;
+        return;
+    }
+#endif
+    GEN_NAME(compact)(map);
+    GEN_SIZE bucketCount = GEN_NAME_(bucketCount)(map->length);
+    if (bucketCount < map->mask + 1) GEN_NAME_(resize)(map, bucketCount);
+}
+
+
+#ifdef MAP_SNAPSHOT
+
+// Fill the snapshot header of a map
+static void GEN_NAME_(header)(GEN_ALGO* map, _map_snapshotHeader* header) {
+    memset(header, 0, sizeof(_map_snapshotHeader));
+    memcpy(header->magic, MAP_SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = MAP_SNAPSHOT_VERSION;
+    header->sizeSize = sizeof(GEN_SIZE);
+    header->hashSize = sizeof(MAP_HASH_TYPE);
+#ifdef MAP_SOA
+    header->itemSize = sizeof(GEN_NAME_(item)) + sizeof(GEN_TYPE);
+    header->flags = MAP_SNAPSHOT_SOA;
+#else
+    header->itemSize = sizeof(GEN_NAME_(item));
+#endif
+#ifdef MAP_STORE_HASH
+    header->flags |= MAP_SNAPSHOT_STORE_HASH;
+#endif
+    header->length = map->length;
+    header->mask = map->mask;
+    header->reusable = map->reusable;
+    header->end = map->end;
+}
+
+
+#ifdef MAP_SOA
+// Offset of the values in a map snapshot file
+static inline size_t GEN_NAME_(valuesOffset)(GEN_ALGO* map) {
+    return MAP_SNAPSHOT_ALIGN(sizeof(_map_snapshotHeader) + sizeof(GEN_NAME_(item)) * map->end, GEN_TYPE);
+}
+#endif
+
+
+// Offset of the buckets in a map snapshot file
+static inline size_t GEN_NAME_(bucketsOffset)(GEN_ALGO* map) {
+#ifdef MAP_SOA
+    return MAP_SNAPSHOT_ALIGN(GEN_NAME_(valuesOffset)(map) + sizeof(GEN_TYPE) * map->end, GEN_SIZE);
+#else
+    return sizeof(_map_snapshotHeader) + sizeof(GEN_NAME_(item)) * map->end;
+#endif
+}
+
+
+// Size of a map snapshot file
+static inline size_t GEN_NAME_(snapshotSize)(GEN_ALGO* map) {
+    return GEN_NAME_(bucketsOffset)(map) + sizeof(GEN_SIZE) * (map->mask + 1);
+}
+
+
+// Write a whole buffer to a file
+static void GEN_NAME_(write)(int fd, const void* data, size_t size) {
+    while (size > 0) {
+        THROW_P(ssize_t written = write(fd, data, size), written < 0);
+        data = (const char*)data + written;
+        size -= written;
+    }
+}
+
+
+void GEN_NAME(save)(GEN_ALGO* map, int fd) {
+#ifdef MAP_INLINE
+    // Snapshots always contain buckets
+    if (map->buckets == NULL) {
+        GEN_ALGO copy = *map;
+        GEN_NAME_(spill)(&copy, 0);
+        GEN_NAME(save)(&copy, fd);
+        GEN_NAME(free)(&copy);
+        return;
+    }
+#endif
+#ifdef MAP_INCREMENTAL
+    GEN_NAME_(migrate)(map, map->mask + 1);
+#endif
+    _map_snapshotHeader header;
+    GEN_NAME_(header)(map, &header);
+    GEN_NAME_(write)(fd, &header, sizeof(header));
+    GEN_NAME_(write)(fd, map->items, sizeof(GEN_NAME_(item)) * map->end);
+#ifdef MAP_SOA
+    // Zeros before the values and the buckets to align them
+    static const char padding[_Alignof(GEN_TYPE) + _Alignof(GEN_SIZE)];
+    size_t offset = sizeof(header) + sizeof(GEN_NAME_(item)) * map->end;
+    GEN_NAME_(write)(fd, padding, GEN_NAME_(valuesOffset)(map) - offset);
+    GEN_NAME_(write)(fd, map->values, sizeof(GEN_TYPE) * map->end);
+    offset = GEN_NAME_(valuesOffset)(map) + sizeof(GEN_TYPE) * map->end;
+    GEN_NAME_(write)(fd, padding, GEN_NAME_(bucketsOffset)(map) - offset);
+#endif
+    GEN_NAME_(write)(fd, map->buckets, sizeof(GEN_SIZE) * (map->mask + 1));
+}
+
+
+GEN_ALGO GEN_NAME(mmap)(const char* path) {
+    THROW_P(int fd = open(path, O_RDONLY), fd < 0);
+    struct stat st;
+    THROW(fstat(fd, &st));
+    if ((size_t)st.st_size < sizeof(_map_snapshotHeader)) THROW_ERR("Invalid map snapshot : %s", path);
+    THROW_P(void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0), data == MAP_FAILED);
+    THROW(close(fd));
+
+    GEN_ALGO map;
+    const _map_snapshotHeader* header = data;
+    _map_snapshotHeader expected;
+    map.length = header->length;
+    map.mask = header->mask;
+    map.reusable = header->reusable;
+    map.end = header->end;
+    map.capacity = map.end;
+    GEN_NAME_(header)(&map, &expected);
+    if (memcmp(header, &expected, sizeof(expected)) != 0 || (size_t)st.st_size != GEN_NAME_(snapshotSize)(&map)) {
+        THROW_ERR("Invalid map snapshot : %s", path);
+    }
+    map.items = (GEN_NAME_(item)*)(header + 1);
+#ifdef MAP_SOA
+    map.values = (GEN_TYPE*)((char*)data + GEN_NAME_(valuesOffset)(&map));
+#endif
+    map.buckets = (GEN_SIZE*)((char*)data + GEN_NAME_(bucketsOffset)(&map));
+#ifdef MAP_FILTER
+    MAP_FILTER_NAME(init)(&map.filter, 0);
+    GEN_NAME_(refilter)(&map, map.length);
+#endif
+#ifdef MAP_INCREMENTAL
+    map.oldBuckets = NULL;
+#endif
+    return map;
+}
+
+
+void GEN_NAME(munmap)(GEN_ALGO* map) {
+#ifdef MAP_FILTER
+    MAP_FILTER_NAME(free)(&map->filter);
+#endif
+    THROW(munmap((_map_snapshotHeader*)map->items - 1, GEN_NAME_(snapshotSize)(map)));
+}
+
+#endif
+
+
 GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key) {
-    GEN_SIZE bucket = MAP_INDEX(MAP_HASH(key), map->mask);
-    GEN_SIZE* index = map->buckets + bucket;
-    while (*index != -1) {
+#ifdef MAP_INLINE
+    if (map->buckets == NULL) {
+        GEN_SIZE index = GEN_NAME_(inlineSearch)(map, key);
+        if (index == GEN_NONE) return 0;
+        // Swap with the last item, which is then outside of the map
+#ifdef MAP_SOA
+        GEN_KEY removedKey = map->inlineKeys[index];
+        GEN_TYPE removedValue = map->inlineValues[index];
+        map->inlineKeys[index] = map->inlineKeys[--map->length];
+        map->inlineValues[index] = map->inlineValues[map->length];
+        map->inlineKeys[map->length] = removedKey;
+        map->inlineValues[map->length] = removedValue;
+#else
+        GEN_KV_TYPE removed = map->inlineItems[index];
+        map->inlineItems[index] = map->inlineItems[--map->length];
+        map->inlineItems[map->length] = removed;
+#endif
+        map->end = map->length;
+        return GEN_IF_VALUE(&MAP_INLINE_VALUE(map, map->length), true);
+    }
+#endif
+#ifdef MAP_INCREMENTAL
+    GEN_NAME_(migrate)(map, MAP_MIGRATE);
+#endif
+    MAP_HASH_TYPE hash = MAP_HASH(key);
+#ifdef MAP_FILTER
+    if (!MAP_FILTER_CONTAINS(map, hash)) return 0;
+#endif
+    GEN_SIZE* index = GEN_NAME_(bucket)(map, hash);
+    while (*index != GEN_NONE) {
         GEN_NAME_(item)* item = map->items + *index;
-        if (GEN_EQUALS(key, GEN_KV_KEY(item->kv))) {
+        if (MAP_MATCH(item, key, hash)) {
             GEN_SIZE next = item->next;
-            item->next = map->reusable;
+            item->next = MAP_REUSABLE(map->reusable);
             map->reusable = *index;
             map->length--;
             *index = next;
-            return GEN_IF_VALUE(&item->kv.value, true);
+#ifdef MAP_FILTER
+            if (!map->unfiltered) MAP_FILTER_NAME(removeHash)(&map->filter, hash);
+#endif
+            return GEN_IF_VALUE(&MAP_VALUE(map, item), true);
         }
         index = &item->next;
     }
@@ -427,6 +1501,29 @@ GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key) {
 
 // Undef parameters for later use
 #undef MAP_HASH
+#undef MAP_HASH_TYPE
+#undef MAP_STORE_HASH
+#undef MAP_ITEM_HASH
+#undef MAP_MATCH
+#undef MAP_KEY
+#undef MAP_VALUE
+#undef MAP_INLINE_KEY
+#undef MAP_INLINE_VALUE
+#undef MAP_SOA
+#undef MAP_REUSABLE
+#undef MAP_USED
 #undef MAP_INDEX
+#undef MAP_INCREMENTAL
+#undef MAP_MIGRATE
+#undef MAP_MAX_LOAD
+#undef MAP_SNAPSHOT
+#undef MAP_FILTER
+#undef MAP_FILTER_NAME
+#undef MAP_FILTER_CONTAINS
+#undef MAP_CAPACITY
+#undef MAP_MAX_CAPACITY
+#undef MAP_BATCH
+#undef MAP_INLINE
+#undef MAP_INLINE_ALL
 
 #include "generic_end.h"
\ No newline at end of file
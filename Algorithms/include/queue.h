@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include "throw.h"
 
 
 /**
@@ -157,6 +158,7 @@ GEN_TYPE GEN_NAME(popLast)(GEN_ALGO* queue);
 
 
 void GEN_NAME_(grow)(GEN_ALGO* queue) {
+    if (queue->mask >= GEN_SIZE_MAX >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)queue->mask + 1);
     GEN_SIZE capacity = (queue->mask + 1) << 1;
     queue->mask = capacity - 1;
     queue->values = THROW_PN(realloc(queue->values, sizeof(GEN_TYPE) * capacity), queue->values);
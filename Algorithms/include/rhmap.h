@@ -0,0 +1,528 @@
+#ifndef GEN_PREFIX
+#define GEN_PREFIX rhmap
+#endif
+#define GEN_KV
+#include "generic_start.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "throw.h"
+
+// Hash map using open addressing with linear probing and Robin Hood insertion : an item takes the slot of an item
+// that is closer to its own first slot, so probe lengths stay short and a search can stop at the first item closer to its slot
+// Removed items are filled by shifting the next items back, so no deleted slots are left
+
+// Additional parameters :
+// MAP_HASH : Hash function for keys (default: the key), mixed before use
+// MAP_MAX_LOAD : Maximum number of items per slot before growing, higher uses less memory for longer probes (default: 0.75, must be less than 1)
+
+#ifndef MAP_HASH
+#define MAP_HASH(key) (key)
+#endif
+
+#ifndef MAP_MAX_LOAD
+#define MAP_MAX_LOAD 0.75
+#endif
+
+#ifndef RHMAP_H
+#define RHMAP_H
+
+// Largest value of [dist] (probe distance + 1), the map grows if an item would be further from its first slot
+#define RHMAP_MAX_DIST 255
+
+#endif
+
+// Number of items that fit in a number of slots
+#define RHMAP_CAPACITY(slots) ((GEN_SIZE)((double)(slots) * (MAP_MAX_LOAD)))
+
+
+/**
+ * @brief Resizable hash map using Robin Hood hashing
+ * @param dist Probe distance of each slot + 1 (0 if the slot is empty)
+ * @param items Items of each slot
+ * @param length Number of items in the map
+ * @param mask Number of slots - 1
+ * @param capacity Number of items that can be added before growing
+**/
+typedef struct {
+    uint8_t* dist;
+    GEN_KV_TYPE* items;
+    GEN_SIZE length;
+    GEN_SIZE mask;
+    GEN_SIZE capacity;
+} GEN_ALGO;
+
+
+/**
+ * @brief Map iterator
+ * @param index Index of the slot
+**/
+typedef struct {
+    GEN_SIZE index;
+} GEN_NAME(iter);
+
+
+/**
+ * @brief Initialize a map
+ * @param map The map
+ * @param capacity Initial capacity
+**/
+inline void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity) {
+    GEN_SIZE slots = 8;
+    while (RHMAP_CAPACITY(slots) < capacity) {
+        // Keep the number of slots at most half of the size range, so -1 is never a slot
+        if (slots >= GEN_SIZE_MAX >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)RHMAP_CAPACITY(slots));
+        slots <<= 1;
+    }
+    map->dist = THROW_PN(calloc(slots, sizeof(uint8_t)), map->dist);
+    map->items = THROW_PN(malloc(sizeof(GEN_KV_TYPE) * slots), map->items);
+    map->length = 0;
+    map->mask = slots - 1;
+    map->capacity = RHMAP_CAPACITY(slots);
+}
+
+
+/**
+ * @brief Create a map
+ * @param capacity Initial capacity
+ * @return The map
+**/
+inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
+    GEN_ALGO map;
+    GEN_NAME(init)(&map, capacity);
+    return map;
+}
+
+
+/**
+ * @brief Free a map
+ * @param map The map
+**/
+inline void GEN_NAME(free)(GEN_ALGO* map) {
+    free(map->dist);
+    free(map->items);
+}
+
+
+#ifndef GEN_NO_VALUE
+
+
+/**
+ * @brief Get an item in a map
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item (usable until next added item), NULL if not found
+**/
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Get an item in a map or create it if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added);
+
+
+/**
+ * @brief Get an item in a map or create it with a default value if not found
+ * @param map The map
+ * @param key Key of the item
+ * @param value Default value
+ * @param added Whether a new item was added (NULL to ignore)
+ * @return Pointer to the value of the item (usable until next added item)
+**/
+inline GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added) {
+    bool _added;
+    GEN_TYPE* pValue = GEN_NAME(refOrEmpty)(map, key, &_added);
+    if (_added) *pValue = value;
+    if (added) *added = _added;
+    return pValue;
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found (undefined otherwise)
+ * @param map The map
+ * @param key The key
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key) {
+    return *GEN_NAME(ref)(map, key);
+}
+
+
+/**
+ * @brief Get the value associated with a key in a map if found or a default value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value Default value
+ * @return The value
+**/
+inline GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    GEN_TYPE* pValue = GEN_NAME(ref)(map, key);
+    return pValue == NULL ? value : *pValue;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map (undefined if not found)
+ * @param map The map
+ * @param key The key
+ * @param value New value
+**/
+inline void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME(ref)(map, key) = value;
+}
+
+
+/**
+ * @brief Replace the value associated with a key in a map if found or create a new item with that value otherwise
+ * @param map The map
+ * @param key The key
+ * @param value New value
+ * @return Whether a new item was added
+**/
+inline bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    *GEN_NAME(refOrEmpty)(map, key, &added) = value;
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Check whether a map contains a key
+ * @param map The map
+ * @param key The key
+ * @return Whether the key was found
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME(ref)(map, key) != NULL;
+}
+#endif
+
+
+#ifndef GEN_NO_VALUE
+/**
+ * @brief Add an item with no value in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the value of the item
+**/
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key);
+#endif
+
+
+/**
+ * @brief Add an item in a map (undefined if it already exists)
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+**/
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    *GEN_NAME_(addEmpty)(map, key) = value;
+}
+#endif
+
+
+/**
+ * @brief Add an item in a map if it does not already exist
+ * @param map The map
+ * @param key Key of the item
+ * @param value Value of the item
+ * @return Whether a new item was added
+**/
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key);
+#else
+inline bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value) {
+    bool added;
+    GEN_NAME(refOrDefault)(map, key, value, &added);
+    return added;
+}
+#endif
+
+
+/**
+ * @brief Remove an item in a map if found
+ * @param map The map
+ * @param key Key of the item
+ * @return Pointer to the removed item (usable until next added item)
+**/
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key);
+
+
+/**
+ * @brief Start iterating on a map
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterStart)(void) {
+    return (GEN_NAME(iter)) { .index = GEN_NONE };
+}
+
+
+/**
+ * @brief Get the next item while iterating on a map
+ * @param map The map
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter) {
+    while ((GEN_SIZE)(iter->index + 1) <= map->mask) {
+        if (map->dist[++iter->index] != 0) return map->items + iter->index;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Get the longest probe distance of the items of a map (number of slots between an item and its first slot)
+ * @param map The map
+ * @return The longest probe distance
+**/
+GEN_SIZE GEN_NAME(maxProbe)(GEN_ALGO* map);
+
+
+/**
+ * @brief Get the mean probe distance of the items of a map (number of slots between an item and its first slot)
+ * @param map The map
+ * @return The mean probe distance
+**/
+double GEN_NAME(meanProbe)(GEN_ALGO* map);
+
+
+#ifdef GEN_SOURCE
+
+
+void GEN_NAME(init)(GEN_ALGO* map, GEN_SIZE capacity);
+GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity);
+void GEN_NAME(free)(GEN_ALGO* map);
+#ifndef GEN_NO_VALUE
+GEN_TYPE* GEN_NAME(refOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value, bool* added);
+GEN_TYPE GEN_NAME(get)(GEN_ALGO* map, GEN_KEY key);
+GEN_TYPE GEN_NAME(getOrDefault)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(set)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(setOrAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key, GEN_TYPE value);
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key);
+#endif
+GEN_NAME(iter) GEN_NAME(iterStart)();
+GEN_KV_TYPE* GEN_NAME(iterNext)(GEN_ALGO* map, GEN_NAME(iter)* iter);
+
+
+// First slot of a key
+static inline GEN_SIZE GEN_NAME_(home)(GEN_ALGO* map, GEN_KEY key) {
+    uint64_t hash = (uint64_t)MAP_HASH(key) * 0x9E3779B97F4A7C15ull;
+    return (hash ^ (hash >> 32)) & map->mask;
+}
+
+
+// Index of the slot of a key if found, -1 otherwise
+static GEN_SIZE GEN_NAME_(search)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(home)(map, key);
+    for (unsigned dist = 1;; dist++) {
+        // Items further than the key would be from its slot have all been checked
+        if (map->dist[index] < dist) return GEN_NONE;
+        if (map->dist[index] == dist && GEN_EQUALS(key, GEN_KV_KEY(map->items[index]))) return index;
+        index = (index + 1) & map->mask;
+    }
+}
+
+
+// Rebuild the map with at least twice as many slots
+static void GEN_NAME_(grow)(GEN_ALGO* map) {
+    uint8_t* oldDist = map->dist;
+    GEN_KV_TYPE* oldItems = map->items;
+    GEN_SIZE oldSlots = map->mask + 1;
+    // Starting after an empty slot, items are visited in the order of their first slot,
+    // so each of them can be placed in the first empty slot without breaking the Robin Hood order
+    GEN_SIZE start = 0;
+    while (oldDist[start] != 0) start++;
+    bool placed = false;
+    while (!placed) {
+        // Grow again if an item of the old slots would be too far from its first slot
+        if (map->mask >= GEN_SIZE_MAX >> 1) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)map->length);
+        GEN_SIZE slots = (map->mask + 1) << 1;
+        map->dist = THROW_PN(calloc(slots, sizeof(uint8_t)), map->dist);
+        map->items = THROW_PN(malloc(sizeof(GEN_KV_TYPE) * slots), map->items);
+        map->mask = slots - 1;
+        placed = true;
+        for (GEN_SIZE i = 0; i < oldSlots && placed; i++) {
+            GEN_SIZE old = (start + 1 + i) & (oldSlots - 1);
+            if (oldDist[old] == 0) continue;
+            GEN_SIZE index = GEN_NAME_(home)(map, GEN_KV_KEY(oldItems[old]));
+            unsigned dist = 1;
+            while (map->dist[index] != 0 && dist <= RHMAP_MAX_DIST) {
+                index = (index + 1) & map->mask;
+                dist++;
+            }
+            if (dist > RHMAP_MAX_DIST) placed = false;
+            else {
+                map->dist[index] = dist;
+                map->items[index] = oldItems[old];
+            }
+        }
+        if (!placed) {
+            free(map->dist);
+            free(map->items);
+        }
+    }
+    map->capacity = RHMAP_CAPACITY(map->mask + 1);
+    free(oldDist);
+    free(oldItems);
+}
+
+
+// Insert a key that is not in the map, return the index of its slot
+static GEN_SIZE GEN_NAME_(insert)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(home)(map, key);
+    unsigned dist = 1;
+    // Skip the items that are as far or further from their first slot
+    while (map->dist[index] >= dist) {
+        index = (index + 1) & map->mask;
+        if (++dist > RHMAP_MAX_DIST) {
+            GEN_NAME_(grow)(map);
+            return GEN_NAME_(insert)(map, key);
+        }
+    }
+    // Shift the next items of the run by one slot to make room for the key
+    GEN_SIZE end = index;
+    while (map->dist[end] != 0) {
+        if (map->dist[end] == RHMAP_MAX_DIST) {
+            GEN_NAME_(grow)(map);
+            return GEN_NAME_(insert)(map, key);
+        }
+        end = (end + 1) & map->mask;
+    }
+    while (end != index) {
+        GEN_SIZE previous = (end - 1) & map->mask;
+        map->dist[end] = map->dist[previous] + 1;
+        map->items[end] = map->items[previous];
+        end = previous;
+    }
+    map->dist[index] = dist;
+    GEN_KV_KEY(map->items[index]) = key;
+    return index;
+}
+
+
+// Add an item for a key that is not in the map
+static GEN_KV_TYPE* GEN_NAME_(addItem)(GEN_ALGO* map, GEN_KEY key) {
+    if (map->length >= map->capacity) GEN_NAME_(grow)(map);
+    map->length++;
+    return map->items + GEN_NAME_(insert)(map, key);
+}
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(contains)(GEN_ALGO* map, GEN_KEY key) {
+    return GEN_NAME_(search)(map, key) != GEN_NONE;
+}
+#else
+GEN_TYPE* GEN_NAME(ref)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    return index == GEN_NONE ? NULL : &map->items[index].value;
+}
+#endif
+
+
+#ifdef GEN_NO_VALUE
+bool GEN_NAME(tryAdd)(GEN_ALGO* map, GEN_KEY key) {
+#else
+GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* map, GEN_KEY key, bool* added) {
+#endif
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    if (index != GEN_NONE) {
+#ifdef GEN_NO_VALUE
+        return false;
+#else
+        if (added) *added = false;
+        return &map->items[index].value;
+#endif
+    }
+#ifdef GEN_NO_VALUE
+    GEN_NAME_(addItem)(map, key);
+    return true;
+#else
+    if (added) *added = true;
+    return &GEN_NAME_(addItem)(map, key)->value;
+#endif
+}
+
+
+#ifdef GEN_NO_VALUE
+void GEN_NAME(add)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_NAME_(addItem)(map, key);
+}
+#else
+GEN_TYPE* GEN_NAME_(addEmpty)(GEN_ALGO* map, GEN_KEY key) {
+    return &GEN_NAME_(addItem)(map, key)->value;
+}
+#endif
+
+
+GEN_IF_VALUE(GEN_TYPE*, bool) GEN_NAME(remove)(GEN_ALGO* map, GEN_KEY key) {
+    GEN_SIZE index = GEN_NAME_(search)(map, key);
+    if (index == GEN_NONE) return 0;
+    map->length--;
+#ifndef GEN_NO_VALUE
+    // The removed item is kept after the map so that the returned pointer stays valid
+    GEN_KV_TYPE removed = map->items[index];
+#endif
+    // Shift back the next items until an empty slot or an item in its first slot
+    GEN_SIZE next = (index + 1) & map->mask;
+    while (map->dist[next] > 1) {
+        map->items[index] = map->items[next];
+        map->dist[index] = map->dist[next] - 1;
+        index = next;
+        next = (next + 1) & map->mask;
+    }
+    map->dist[index] = 0;
+#ifdef GEN_NO_VALUE
+    return true;
+#else
+    map->items[index] = removed;
+    return &map->items[index].value;
+#endif
+}
+
+
+GEN_SIZE GEN_NAME(maxProbe)(GEN_ALGO* map) {
+    GEN_SIZE max = 0;
+    for (GEN_SIZE i = 0; i <= map->mask; i++) {
+        if (map->dist[i] > max + 1) max = map->dist[i] - 1;
+    }
+    return max;
+}
+
+
+double GEN_NAME(meanProbe)(GEN_ALGO* map) {
+    uint64_t sum = 0;
+    for (GEN_SIZE i = 0; i <= map->mask; i++) {
+        if (map->dist[i] != 0) sum += map->dist[i] - 1;
+    }
+    return map->length == 0 ? 0 : (double)sum / map->length;
+}
+
+
+#endif
+
+
+// Undef parameters for later use
+#undef MAP_HASH
+#undef MAP_MAX_LOAD
+#undef RHMAP_CAPACITY
+
+#include "generic_end.h"
@@ -16,13 +16,15 @@
 #define SORT_KEY(item) (item)
 #endif
 
+#ifndef SORT_H
+#define SORT_H
+
 // Not standard but most likely works
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
 static inline int32_t floatToInt(float f) { return *(int32_t*)&f; }
 static inline int64_t doubleToInt(double d) { return *(int64_t*)&d; }
 #pragma GCC diagnostic pop
-#pragma GCC diagnostic pop
 
 // Keys for signed integer and floating point types (GEN_TYPE must be the unsigned integer type with the same size)
 #define SORT_SIGNED(item) ((GEN_KEY)(item) ^ ((GEN_KEY)1 << (sizeof(GEN_KEY) * CHAR_BIT - 1)))
@@ -33,6 +35,8 @@ static inline int64_t doubleToInt(double d) { return *(int64_t*)&d; }
 #define SORT_QUICK_THRESH 32
 #define SORT_RADIX_THRESH (64 * sizeof(GEN_KEY))
 
+#endif
+
 // Comparisons
 #ifdef SORT_COMPARABLE
 #define SORT_GT(item1, item2) GEN_COMPARE(SORT_KEY(item1), SORT_KEY(item2)) > 0
@@ -232,5 +236,7 @@ void GEN_NAME(radix)(GEN_TYPE* items, GEN_SIZE n) {
 
 #undef SORT_COMPARABLE
 #undef SORT_KEY
+#undef SORT_GT
+#undef SORT_LT
 
 #include "generic_end.h"
\ No newline at end of file
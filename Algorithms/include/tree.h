@@ -6,10 +6,16 @@
 #include <stdbool.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
 #include "throw.h"
 
 // Additional parameters :
 // TREE_SIZE : Whether subtrees contain their size (required to count the size of a range without iterating) (default: false)
+// TREE_PARALLEL_HEIGHT : Smallest black height of a sub-tree for which set operations start a new thread (default: 10)
+
+#ifndef TREE_PARALLEL_HEIGHT
+#define TREE_PARALLEL_HEIGHT 10
+#endif
 
 // Stack size
 #define TREE_STACK (2 * (sizeof(GEN_SIZE) * CHAR_BIT - 1))
@@ -31,7 +37,14 @@ typedef struct {
 #endif
 } GEN_NAME_(item);
 
-#define TREE_RED ((GEN_SIZE)1 << (sizeof(GEN_SIZE) * CHAR_BIT - 1))
+// Highest bit of GEN_SIZE, shifted as an unsigned integer so that it is also defined for signed types
+#define TREE_RED ((GEN_SIZE)((uintmax_t)1 << (sizeof(GEN_SIZE) * CHAR_BIT - 1)))
+
+// Largest capacity, so that indices do not use the highest bit
+// A tree holds at most half of the size range: the color of a node is the highest bit of the link from its parent,
+// so rotations and color flips only rewrite links. A separate color byte would pad every item (25% more memory
+// for int keys and values with 32 bits sizes), a wider GEN_SIZE raises the limit instead
+#define TREE_MAX_CAPACITY ((GEN_SIZE)~TREE_RED)
 
 
 /**
@@ -63,17 +76,21 @@ typedef struct {
 
 /**
  * @brief Tree iterator
+ * @param stack Path to the current item, the items on the path are the next items if it has no right child
+ * @param top Index of the current item in [stack]
+ * @param end Index of the first item after the iterated range, 0 if the range has no end
 **/
 typedef struct {
     GEN_SIZE stack[TREE_STACK];
     int top;
+    GEN_SIZE end;
 } GEN_NAME(iter);
 
 
 /**
  * @brief Initialize a tree
  * @param tree The tree
- * @param capacity Initial capacity (must be a power of 2)
+ * @param capacity Initial capacity (at least 1)
 **/
 inline void GEN_NAME(init)(GEN_ALGO* tree, GEN_SIZE capacity) {
     tree->items = THROW_PN(malloc(sizeof(GEN_NAME_(item)) * capacity), tree->items);
@@ -85,13 +102,13 @@ inline void GEN_NAME(init)(GEN_ALGO* tree, GEN_SIZE capacity) {
     };
     tree->length = 0;
     tree->capacity = capacity;
-    tree->reusable = -1;
+    tree->reusable = GEN_NONE;
 }
 
 
 /**
  * @brief Create a tree
- * @param capacity Initial capacity (must be a power of 2)
+ * @param capacity Initial capacity (at least 1)
  * @return The tree
 **/
 inline GEN_ALGO GEN_NAME(new)(GEN_SIZE capacity) {
@@ -110,6 +127,21 @@ inline void GEN_NAME(free)(GEN_ALGO* tree) {
 }
 
 
+/**
+ * @brief Create a balanced tree containing the keys (and values) of sorted arrays in O(n) without comparisons,
+ * with the items stored in breadth-first order (the keys must be sorted and distinct)
+ * @param keys Keys of the items
+ * @param values Values of the items
+ * @param n Number of items
+ * @return The tree
+**/
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromSorted)(GEN_KEY* keys, GEN_SIZE n);
+#else
+GEN_ALGO GEN_NAME(fromSorted)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n);
+#endif
+
+
 #ifndef GEN_NO_VALUE
 /**
  * @brief Get an item in a tree
@@ -235,19 +267,32 @@ inline GEN_NAME(iter) GEN_NAME(iterAll)(void) {
     GEN_NAME(iter) iter;
     iter.top = 0;
     iter.stack[0] = 0;
+    iter.end = 0;
     return iter;
 }
 
 
-/**
- * @brief Start iterating on a sub-tree
- * @param tree The tree
- * @param start Start key of the sub-tree (inclusive)
- * @return The iterator
-**/
-inline GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start) {
+// Index of the first item with a key greater or equal (inclusive) or greater (exclusive) than a key, 0 if not found
+inline GEN_SIZE GEN_NAME_(bound)(GEN_ALGO* tree, GEN_KEY key, bool inclusive) {
+    GEN_SIZE bound = 0;
+    GEN_SIZE index = tree->items[0].children[1];
+    while (index != 0) {
+        index &= ~TREE_RED;
+        GEN_NAME_(item)* item = tree->items + index;
+        GEN_COMPARE_TYPE cmp = GEN_COMPARE(key, GEN_KV_KEY(item->kv));
+        bool left = inclusive ? cmp <= 0 : cmp < 0;
+        if (left) bound = index;
+        index = item->children[!left];
+    }
+    return bound;
+}
+
+
+// Iterator positioned before the first item with a key greater or equal (inclusive) or greater (exclusive) than a key
+inline GEN_NAME(iter) GEN_NAME_(seek)(GEN_ALGO* tree, GEN_KEY start, bool inclusive) {
     GEN_NAME(iter) iter;
     iter.top = 0;
+    iter.end = 0;
     int top = -1;
     GEN_SIZE prevIndex = 0;
     GEN_SIZE index = tree->items[0].children[1];
@@ -255,12 +300,13 @@ inline GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start) {
         index &= ~TREE_RED;
         GEN_NAME_(item)* item = tree->items + index;
         GEN_COMPARE_TYPE cmp = GEN_COMPARE(start, GEN_KV_KEY(item->kv));
-        if (cmp <= 0) iter.stack[++top] = index;
-        if (cmp > 0) {
+        bool left = inclusive ? cmp <= 0 : cmp < 0;
+        if (left) iter.stack[++top] = index;
+        else {
             iter.top = top + 1;
             prevIndex = index;
         }
-        index = item->children[cmp > 0];
+        index = item->children[!left];
     }
     iter.stack[iter.top] = prevIndex;
     return iter;
@@ -270,11 +316,42 @@ inline GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start) {
 /**
  * @brief Start iterating on a sub-tree
  * @param tree The tree
- * @param end End key of the sub-tree (inclusive)
+ * @param start Start key of the sub-tree
+ * @param startInclusive Whether the sub-tree contains [start]
+ * @param end End key of the sub-tree
+ * @param endInclusive Whether the sub-tree contains [end]
+ * @return The iterator, the range is found in O(log n) and the iteration stops at [end] without comparing keys
+**/
+inline GEN_NAME(iter) GEN_NAME(iterRange)(GEN_ALGO* tree, GEN_KEY start, bool startInclusive, GEN_KEY end, bool endInclusive) {
+    GEN_NAME(iter) iter = GEN_NAME_(seek)(tree, start, startInclusive);
+    GEN_COMPARE_TYPE cmp = GEN_COMPARE(start, end);
+    if (cmp < 0 || (cmp == 0 && startInclusive && endInclusive)) iter.end = GEN_NAME_(bound)(tree, end, !endInclusive);
+    else iter.end = GEN_NAME_(bound)(tree, start, startInclusive); // Empty range
+    return iter;
+}
+
+
+/**
+ * @brief Start iterating on a sub-tree
+ * @param tree The tree
+ * @param start Start key of the sub-tree (inclusive)
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start) {
+    return GEN_NAME_(seek)(tree, start, true);
+}
+
+
+/**
+ * @brief Start iterating on a sub-tree
+ * @param tree The tree
+ * @param end End key of the sub-tree (exclusive)
  * @return The iterator
 **/
 inline GEN_NAME(iter) GEN_NAME(iterBefore)(GEN_ALGO* tree, GEN_KEY end) {
-    return GEN_NAME(iterAll)();
+    GEN_NAME(iter) iter = GEN_NAME(iterAll)();
+    iter.end = GEN_NAME_(bound)(tree, end, true);
+    return iter;
 }
 
 
@@ -286,31 +363,42 @@ inline GEN_NAME(iter) GEN_NAME(iterBefore)(GEN_ALGO* tree, GEN_KEY end) {
  * @return The iterator
 **/
 inline GEN_NAME(iter) GEN_NAME(iterBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end) {
-    return GEN_NAME(iterAfter)(tree, start);
+    return GEN_NAME(iterRange)(tree, start, true, end, false);
 }
 
 
 /**
- * @brief Get the next item while iterating on a tree
+ * @brief Get the next item while iterating on a tree or a sub-tree
  * @param tree The tree
  * @param iter The iterator
  * @return Next item, NULL if no more items
 **/
-inline GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter) {
+inline GEN_KV_TYPE* GEN_NAME(next)(GEN_ALGO* tree, GEN_NAME(iter)* iter) {
     GEN_NAME_(item)* item = tree->items + iter->stack[iter->top];
     iter->top--;
-    if (item->children[1] != 0) {
-        GEN_SIZE index = item->children[1];
+    GEN_SIZE index = item->children[1];
+    if (index != 0) {
         do {
             index &= ~TREE_RED;
-            item = tree->items + index;
             iter->stack[++iter->top] = index;
-            index = item->children[0];
+            index = tree->items[index].children[0];
         } while (index != 0);
-        return &item->kv;
     }
-    else if (iter->top >= 0) return &tree->items[iter->stack[iter->top]].kv;
-    return NULL;
+    else if (iter->top < 0) return NULL;
+    index = iter->stack[iter->top];
+    if (index == iter->end) return NULL;
+    return &tree->items[index].kv;
+}
+
+
+/**
+ * @brief Get the next item while iterating on a tree
+ * @param tree The tree
+ * @param iter The iterator
+ * @return Next item, NULL if no more items
+**/
+inline GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter) {
+    return GEN_NAME(next)(tree, iter);
 }
 
 
@@ -322,7 +410,7 @@ inline GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter) {
  * @return Next item, NULL if no more items
 **/
 inline GEN_KV_TYPE* GEN_NAME(nextAfter)(GEN_ALGO* tree, GEN_KEY start, GEN_NAME(iter)* iter) {
-    return GEN_NAME(nextAll)(tree, iter);
+    return GEN_NAME(next)(tree, iter);
 }
 
 
@@ -330,13 +418,11 @@ inline GEN_KV_TYPE* GEN_NAME(nextAfter)(GEN_ALGO* tree, GEN_KEY start, GEN_NAME(
  * @brief Get the next item while iterating on a sub-tree
  * @param tree The tree
  * @param end End key of the sub-tree (exclusive)
- * @param iter The iterator
+ * @param iter The iterator (from [iterBefore])
  * @return Next item, NULL if no more items
 **/
 inline GEN_KV_TYPE* GEN_NAME(nextBefore)(GEN_ALGO* tree, GEN_KEY end, GEN_NAME(iter)* iter) {
-    GEN_KV_TYPE* kv = GEN_NAME(nextAll)(tree, iter);
-    if (kv == NULL || GEN_COMPARE(GEN_KV_KEY(*kv), end) >= 0) return NULL;
-    return kv;
+    return GEN_NAME(next)(tree, iter);
 }
 
 
@@ -345,11 +431,29 @@ inline GEN_KV_TYPE* GEN_NAME(nextBefore)(GEN_ALGO* tree, GEN_KEY end, GEN_NAME(i
  * @param tree The tree
  * @param start Start key of the sub-tree (inclusive)
  * @param end End key of the sub-tree (exclusive)
- * @param iter The iterator
+ * @param iter The iterator (from [iterBetween])
  * @return Next item, NULL if no more items
 **/
 inline GEN_KV_TYPE* GEN_NAME(nextBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end, GEN_NAME(iter)* iter) {
-    return GEN_NAME(nextBefore)(tree, end, iter);
+    return GEN_NAME(next)(tree, iter);
+}
+
+
+/**
+ * @brief Call a function on every item of a sub-tree in order
+ * @param tree The tree
+ * @param start Start key of the sub-tree
+ * @param startInclusive Whether the sub-tree contains [start]
+ * @param end End key of the sub-tree
+ * @param endInclusive Whether the sub-tree contains [end]
+ * @param f The function, called with an item and [data] (can be inlined if known at compile time)
+ * @param data Data passed to [f]
+**/
+inline void GEN_NAME(forRange)(GEN_ALGO* tree, GEN_KEY start, bool startInclusive, GEN_KEY end, bool endInclusive,
+                               void (*f)(GEN_KV_TYPE* item, void* data), void* data) {
+    GEN_NAME(iter) iter = GEN_NAME(iterRange)(tree, start, startInclusive, end, endInclusive);
+    GEN_KV_TYPE* item;
+    while ((item = GEN_NAME(next)(tree, &iter))) f(item, data);
 }
 
 
@@ -357,14 +461,16 @@ inline GEN_KV_TYPE* GEN_NAME(nextBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY
  * @brief Get the closest item with a key smaller or equal to a given key in a tree
  * @param tree The tree
  * @param key The key
+ * @return The item, NULL if not found
 **/
 GEN_KV_TYPE* GEN_NAME(floor)(GEN_ALGO* tree, GEN_KEY key);
 
 
 /**
- * @brief Get the closest item with a key greater than a given key in a tree
+ * @brief Get the closest item with a key greater or equal to a given key in a tree
  * @param tree The tree
  * @param key The key
+ * @return The item, NULL if not found
 **/
 GEN_KV_TYPE* GEN_NAME(ceil)(GEN_ALGO* tree, GEN_KEY key);
 
@@ -406,9 +512,132 @@ inline GEN_SIZE GEN_NAME(countBefore)(GEN_ALGO* tree, GEN_KEY end) {
 **/
 GEN_SIZE GEN_NAME(countBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end);
 
+
+/**
+ * @brief Get the rank of a key in a tree in O(log n)
+ * @param tree The tree
+ * @param key The key
+ * @return Number of items with a smaller key (index of the key if found)
+**/
+inline GEN_SIZE GEN_NAME(rank)(GEN_ALGO* tree, GEN_KEY key) {
+    return GEN_NAME(countBefore)(tree, key);
+}
+
+
+/**
+ * @brief Get the item at a given index in sorted order in a tree in O(log n)
+ * @param tree The tree
+ * @param k Index of the item (0 for the smallest key)
+ * @return The item, NULL if [k] is not smaller than the length of the tree
+**/
+GEN_KV_TYPE* GEN_NAME(select)(GEN_ALGO* tree, GEN_SIZE k);
+
+
+/**
+ * @brief Start iterating on a tree from a given index in sorted order in O(log n)
+ * @param tree The tree
+ * @param k Index of the first item (0 for the smallest key)
+ * @return The iterator
+**/
+inline GEN_NAME(iter) GEN_NAME(iterAt)(GEN_ALGO* tree, GEN_SIZE k) {
+    GEN_NAME(iter) iter;
+    iter.top = 0;
+    iter.end = 0;
+    int top = -1;
+    GEN_SIZE prevIndex = 0;
+    GEN_SIZE index = tree->items[0].children[1];
+    while (index != 0) {
+        index &= ~TREE_RED;
+        GEN_NAME_(item)* item = tree->items + index;
+        GEN_SIZE leftSize = tree->items[item->children[0] & ~TREE_RED].size;
+        bool left = k <= leftSize;
+        if (left) iter.stack[++top] = index;
+        else {
+            iter.top = top + 1;
+            prevIndex = index;
+            k -= leftSize + 1;
+        }
+        index = item->children[!left];
+    }
+    iter.stack[iter.top] = prevIndex;
+    return iter;
+}
+
+
+/**
+ * @brief Get the item at a given percentile in a tree in O(log n) (nearest rank)
+ * @param tree The tree
+ * @param p The percentile, between 0 and 1 (0.5 for the median, 0.99 for p99)
+ * @return The smallest item with at least [p] of the items smaller or equal to it, NULL if the tree is empty
+**/
+inline GEN_KV_TYPE* GEN_NAME(percentile)(GEN_ALGO* tree, double p) {
+    if (tree->length == 0) return NULL;
+    double rank = p * (double)tree->length; // Index of the item is ceil(rank) - 1
+    GEN_SIZE k = rank <= 1 ? 0 : rank >= (double)tree->length ? tree->length - 1 : (GEN_SIZE)rank - ((GEN_SIZE)rank == rank);
+    return GEN_NAME(select)(tree, k);
+}
+
+#endif
+
+
+/**
+ * @brief Add the items of a tree to another tree, the values of [b] replace the values of the keys in both trees
+ * (join-based, O(m log(n / m + 1)) comparisons after copying [b] into the items of [a] in O(m))
+ * @param a The tree
+ * @param b Items to add (not modified)
+ * @param threads Maximum number of threads used by the recursion
+**/
+void GEN_NAME(union)(GEN_ALGO* a, GEN_ALGO* b, int threads);
+
+
+/**
+ * @brief Remove the items of a tree whose key is not in another tree
+ * (join-based, O(m log(n / m + 1)) comparisons)
+ * @param a The tree
+ * @param b Keys to keep (not modified)
+ * @param threads Maximum number of threads used by the recursion
+**/
+void GEN_NAME(intersect)(GEN_ALGO* a, GEN_ALGO* b, int threads);
+
+
+/**
+ * @brief Remove the items of a tree whose key is in another tree
+ * (join-based, O(m log(n / m + 1)) comparisons)
+ * @param a The tree
+ * @param b Keys to remove (not modified)
+ * @param threads Maximum number of threads used by the recursion
+**/
+void GEN_NAME(difference)(GEN_ALGO* a, GEN_ALGO* b, int threads);
+
+
+/**
+ * @brief Add or replace the items of sorted arrays in a tree (the keys must be sorted and distinct),
+ * equivalent to setOrAdd on each item but the items are built into a balanced tree and merged with a union
+ * @param tree The tree
+ * @param keys Keys of the items
+ * @param values Values of the items
+ * @param n Number of items
+ * @param threads Maximum number of threads used by the recursion
+**/
+#ifdef GEN_NO_VALUE
+void GEN_NAME(insertBatch)(GEN_ALGO* tree, GEN_KEY* keys, GEN_SIZE n, int threads);
+#else
+void GEN_NAME(insertBatch)(GEN_ALGO* tree, GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n, int threads);
 #endif
 
 
+/**
+ * @brief Split a tree into the items with a key smaller than a key and the other items in O(log n + min(l, r)),
+ * the larger part keeps the items of the tree and the smaller part is copied into a new tree
+ * @param a The tree (moved into [left] or [right], must not be used or freed afterwards)
+ * @param key The key
+ * @param left Tree of the items with a key smaller than [key] (can be [a])
+ * @param right Tree of the items with a key greater or equal to [key] (can be [a])
+**/
+void GEN_NAME(split)(GEN_ALGO* a, GEN_KEY key, GEN_ALGO* left, GEN_ALGO* right);
+
+
+
 #ifdef GEN_SOURCE
 
 
@@ -425,22 +654,32 @@ bool GEN_NAME(contains)(GEN_ALGO* tree, GEN_KEY key);
 bool GEN_NAME(tryAdd)(GEN_ALGO* tree, GEN_KEY key, GEN_TYPE value);
 #endif
 GEN_NAME(iter) GEN_NAME(iterAll)();
+GEN_SIZE GEN_NAME_(bound)(GEN_ALGO* tree, GEN_KEY key, bool inclusive);
+GEN_NAME(iter) GEN_NAME_(seek)(GEN_ALGO* tree, GEN_KEY start, bool inclusive);
+GEN_NAME(iter) GEN_NAME(iterRange)(GEN_ALGO* tree, GEN_KEY start, bool startInclusive, GEN_KEY end, bool endInclusive);
 GEN_NAME(iter) GEN_NAME(iterAfter)(GEN_ALGO* tree, GEN_KEY start);
 GEN_NAME(iter) GEN_NAME(iterBefore)(GEN_ALGO* tree, GEN_KEY end);
 GEN_NAME(iter) GEN_NAME(iterBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end);
+GEN_KV_TYPE* GEN_NAME(next)(GEN_ALGO* tree, GEN_NAME(iter)* iter);
 GEN_KV_TYPE* GEN_NAME(nextAll)(GEN_ALGO* tree, GEN_NAME(iter)* iter);
 GEN_KV_TYPE* GEN_NAME(nextAfter)(GEN_ALGO* tree, GEN_KEY start, GEN_NAME(iter)* iter);
 GEN_KV_TYPE* GEN_NAME(nextBefore)(GEN_ALGO* tree, GEN_KEY end, GEN_NAME(iter)* iter);
 GEN_KV_TYPE* GEN_NAME(nextBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end, GEN_NAME(iter)* iter);
+void GEN_NAME(forRange)(GEN_ALGO* tree, GEN_KEY start, bool startInclusive, GEN_KEY end, bool endInclusive,
+                        void (*f)(GEN_KV_TYPE* item, void* data), void* data);
 #ifdef TREE_SIZE
 GEN_SIZE GEN_NAME(countAfter)(GEN_ALGO* tree, GEN_KEY start);
 GEN_SIZE GEN_NAME(countBefore)(GEN_ALGO* tree, GEN_KEY end);
+GEN_SIZE GEN_NAME(rank)(GEN_ALGO* tree, GEN_KEY key);
+GEN_NAME(iter) GEN_NAME(iterAt)(GEN_ALGO* tree, GEN_SIZE k);
+GEN_KV_TYPE* GEN_NAME(percentile)(GEN_ALGO* tree, double p);
 #endif
 
 
 inline void GEN_NAME_(grow)(GEN_ALGO* tree) {
     if (tree->length + 2 >= tree->capacity) {
-        tree->capacity <<= 1;
+        if (tree->capacity == TREE_MAX_CAPACITY) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)tree->capacity);
+        tree->capacity = tree->capacity > TREE_MAX_CAPACITY >> 1 ? TREE_MAX_CAPACITY : tree->capacity << 1;
         tree->items = THROW_PN(realloc(tree->items, sizeof(GEN_NAME_(item)) * tree->capacity), tree->items);
     }
 }
@@ -571,6 +810,55 @@ static inline GEN_NAME_(dir)* GEN_NAME_(maintainRemove)(GEN_ALGO* tree, GEN_NAME
 }
 
 
+#ifdef GEN_NO_VALUE
+GEN_ALGO GEN_NAME(fromSorted)(GEN_KEY* keys, GEN_SIZE n) {
+#else
+GEN_ALGO GEN_NAME(fromSorted)(GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n) {
+#endif
+    if (n > TREE_MAX_CAPACITY - 2) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)(TREE_MAX_CAPACITY - 2));
+    GEN_ALGO tree = GEN_NAME(new)(n + 2);
+    tree.length = n;
+    if (n == 0) return tree;
+
+    // Complete tree where the children of item i are items 2i and 2i + 1, the items of the last level are red
+    GEN_SIZE lastLevel = 1;
+    while (lastLevel <= n >> 1) lastLevel <<= 1;
+    for (GEN_SIZE i = 1; i <= n; i++) {
+        GEN_NAME_(item)* item = tree.items + i;
+        GEN_SIZE left = i <= n >> 1 ? i << 1 : 0;
+        GEN_SIZE right = i <= (n - 1) >> 1 ? (i << 1) + 1 : 0;
+        item->children[0] = left >= lastLevel && lastLevel > 1 ? left | TREE_RED : left;
+        item->children[1] = right >= lastLevel && lastLevel > 1 ? right | TREE_RED : right;
+    }
+    tree.items[0].children[1] = 1;
+
+    // Fill the items in order
+    GEN_SIZE i = lastLevel;
+    for (GEN_SIZE k = 0; k < n; k++) {
+        GEN_KV_KEY(tree.items[i].kv) = keys[k];
+#ifndef GEN_NO_VALUE
+        tree.items[i].kv.value = values[k];
+#endif
+        if (i <= (n - 1) >> 1) { // Leftmost item of the right sub-tree
+            i = (i << 1) + 1;
+            while (i <= n >> 1) i <<= 1;
+        }
+        else { // First ancestor on the right
+            while (i & 1) i >>= 1;
+            i >>= 1;
+        }
+    }
+
+#ifdef TREE_SIZE
+    for (GEN_SIZE j = n; j > 0; j--) {
+        GEN_NAME_(item)* item = tree.items + j;
+        item->size = 1 + tree.items[item->children[0] & ~TREE_RED].size + tree.items[item->children[1] & ~TREE_RED].size;
+    }
+#endif
+    return tree;
+}
+
+
 #ifdef GEN_NO_VALUE
 bool GEN_NAME(contains)(GEN_ALGO* tree, GEN_KEY key) {
 #else
@@ -630,7 +918,7 @@ GEN_TYPE* GEN_NAME(refOrEmpty)(GEN_ALGO* tree, GEN_KEY key, bool* added) {
     // Add item
     tree->length++;
     GEN_SIZE i;
-    if (tree->reusable != -1) {
+    if (tree->reusable != GEN_NONE) {
         i = tree->reusable;
         tree->reusable = tree->items[i].children[0];
     }
@@ -738,7 +1026,7 @@ GEN_KV_TYPE* GEN_NAME(floor)(GEN_ALGO* tree, GEN_KEY key) {
             index = item->children[1];
         }
     }
-    return &floor->kv;
+    return floor == NULL ? NULL : &floor->kv;
 }
 
 
@@ -754,7 +1042,7 @@ GEN_KV_TYPE* GEN_NAME(ceil)(GEN_ALGO* tree, GEN_KEY key) {
             index = item->children[0];
         }
     }
-    return &ceil->kv;
+    return ceil == NULL ? NULL : &ceil->kv;
 }
 
 
@@ -805,14 +1093,489 @@ GEN_SIZE GEN_NAME(countBetween)(GEN_ALGO* tree, GEN_KEY start, GEN_KEY end) {
     return 0;
 }
 
+
+GEN_KV_TYPE* GEN_NAME(select)(GEN_ALGO* tree, GEN_SIZE k) {
+    GEN_SIZE index = tree->items[0].children[1];
+    while (index != 0) {
+        GEN_NAME_(item)* item = tree->items + (index & ~TREE_RED);
+        GEN_SIZE leftSize = tree->items[item->children[0] & ~TREE_RED].size;
+        if (k < leftSize) index = item->children[0];
+        else if (k == leftSize) return &item->kv;
+        else {
+            k -= leftSize + 1;
+            index = item->children[1];
+        }
+    }
+    return NULL;
+}
+
 #endif
 
 
+// Set operations
+#define TREE_UNION 0
+#define TREE_INTERSECT 1
+#define TREE_DIFFERENCE 2
+
+
+// Sub-tree given by the link to its root (with its color) and its black height (number of black items on a path to a leaf)
+typedef struct {
+    GEN_SIZE link;
+    int height;
+} GEN_NAME_(sub);
+
+
+// List of removed items linked by children[0]
+typedef struct {
+    GEN_SIZE first;
+    GEN_SIZE last;
+    GEN_SIZE count;
+} GEN_NAME_(removed);
+
+
+// Set operation between a sub-tree of a tree and a sub-tree of the same tree (union) or of another tree
+typedef struct {
+    GEN_NAME_(item)* items;
+    const GEN_NAME_(item)* otherItems;
+    int op;
+    int threads;
+    GEN_NAME_(sub) a;
+    GEN_NAME_(sub) b;
+    GEN_NAME_(sub) result;
+    GEN_NAME_(removed) removed;
+} GEN_NAME_(task);
+
+
+// Update the size of an item from its children
+static inline void GEN_NAME_(update)(GEN_NAME_(item)* items, GEN_SIZE index) {
+#ifdef TREE_SIZE
+    items[index].size = 1 + items[items[index].children[0] & ~TREE_RED].size + items[items[index].children[1] & ~TREE_RED].size;
+#else
+    (void)items;
+    (void)index;
+#endif
+}
+
+
+// Black height of a sub-tree
+static inline int GEN_NAME_(height)(const GEN_NAME_(item)* items, GEN_SIZE link) {
+    int height = 0;
+    while (link != 0) {
+        height += !(link & TREE_RED);
+        link = items[link & ~TREE_RED].children[0];
+    }
+    return height;
+}
+
+
+// Attach [k] and [s] along the [dir] spine of [t] at the first black item with the black height of [s] (lower than the black height of [t])
+static GEN_SIZE GEN_NAME_(joinSide)(GEN_NAME_(item)* items, GEN_SIZE t, int tHeight, GEN_SIZE k, GEN_SIZE s, int sHeight, GEN_SIZE dir) {
+    if (!(t & TREE_RED) && tHeight == sHeight) {
+        items[k].children[dir ^ 1] = t;
+        items[k].children[dir] = s;
+        GEN_NAME_(update)(items, k);
+        return k | TREE_RED;
+    }
+    GEN_SIZE index = t & ~TREE_RED;
+    GEN_NAME_(item)* item = items + index;
+    GEN_SIZE child = GEN_NAME_(joinSide)(items, item->children[dir], tHeight - !(t & TREE_RED), k, s, sHeight, dir);
+    item->children[dir] = child;
+    GEN_NAME_(update)(items, index);
+    GEN_SIZE childIndex = child & ~TREE_RED;
+    if (!(t & TREE_RED) && (child & TREE_RED) && (items[childIndex].children[dir] & TREE_RED)) { // Rotate
+        item->children[dir] = items[childIndex].children[dir ^ 1];
+        items[childIndex].children[dir ^ 1] = index;
+        items[childIndex].children[dir] &= ~TREE_RED;
+        GEN_NAME_(update)(items, index);
+        GEN_NAME_(update)(items, childIndex);
+        return childIndex | TREE_RED;
+    }
+    return t;
+}
+
+
+// Join two sub-trees with an item between them (all keys of [left] are smaller than the key of [k], all keys of [right] are greater)
+static GEN_NAME_(sub) GEN_NAME_(join)(GEN_NAME_(item)* items, GEN_NAME_(sub) left, GEN_SIZE k, GEN_NAME_(sub) right) {
+    if (left.link & TREE_RED) {
+        left.link &= ~TREE_RED;
+        left.height++;
+    }
+    if (right.link & TREE_RED) {
+        right.link &= ~TREE_RED;
+        right.height++;
+    }
+    GEN_NAME_(sub) result;
+    if (left.height > right.height) {
+        result.link = GEN_NAME_(joinSide)(items, left.link, left.height, k, right.link, right.height, 1);
+        result.height = left.height;
+    }
+    else if (left.height < right.height) {
+        result.link = GEN_NAME_(joinSide)(items, right.link, right.height, k, left.link, left.height, 0);
+        result.height = right.height;
+    }
+    else {
+        items[k].children[0] = left.link;
+        items[k].children[1] = right.link;
+        GEN_NAME_(update)(items, k);
+        result.link = k;
+        result.height = left.height + 1;
+        return result;
+    }
+    if (result.link & TREE_RED) {
+        result.link &= ~TREE_RED;
+        result.height++;
+    }
+    return result;
+}
+
+
+// Split a sub-tree into the items with a key smaller and greater than a key, [found] is the index of the item with that key (0 if not found)
+static void GEN_NAME_(splitSub)(GEN_NAME_(item)* items, GEN_NAME_(sub) t, GEN_KEY key, GEN_NAME_(sub)* left, GEN_NAME_(sub)* right, GEN_SIZE* found) {
+    if (t.link == 0) {
+        *left = *right = t;
+        *found = 0;
+        return;
+    }
+    GEN_SIZE index = t.link & ~TREE_RED;
+    GEN_NAME_(item)* item = items + index;
+    int height = t.height - !(t.link & TREE_RED);
+    GEN_NAME_(sub) l = { item->children[0], height };
+    GEN_NAME_(sub) r = { item->children[1], height };
+    GEN_COMPARE_TYPE cmp = GEN_COMPARE(key, GEN_KV_KEY(item->kv));
+    if (cmp == 0) {
+        *left = l;
+        *right = r;
+        *found = index;
+    }
+    else if (cmp < 0) {
+        GEN_NAME_(splitSub)(items, l, key, left, &l, found);
+        *right = GEN_NAME_(join)(items, l, index, r);
+    }
+    else {
+        GEN_NAME_(splitSub)(items, r, key, &r, right, found);
+        *left = GEN_NAME_(join)(items, l, index, r);
+    }
+}
+
+
+// Remove the first item of a non-empty sub-tree
+static GEN_NAME_(sub) GEN_NAME_(splitFirst)(GEN_NAME_(item)* items, GEN_NAME_(sub) t, GEN_SIZE* first) {
+    GEN_SIZE index = t.link & ~TREE_RED;
+    GEN_NAME_(item)* item = items + index;
+    int height = t.height - !(t.link & TREE_RED);
+    GEN_NAME_(sub) l = { item->children[0], height };
+    GEN_NAME_(sub) r = { item->children[1], height };
+    if (l.link == 0) {
+        *first = index;
+        return r;
+    }
+    return GEN_NAME_(join)(items, GEN_NAME_(splitFirst)(items, l, first), index, r);
+}
+
+
+// Join two sub-trees (all keys of [left] are smaller than the keys of [right])
+static GEN_NAME_(sub) GEN_NAME_(join2)(GEN_NAME_(item)* items, GEN_NAME_(sub) left, GEN_NAME_(sub) right) {
+    if (right.link == 0) return left;
+    GEN_SIZE first;
+    right = GEN_NAME_(splitFirst)(items, right, &first);
+    return GEN_NAME_(join)(items, left, first, right);
+}
+
+
+static inline void GEN_NAME_(pushRemoved)(GEN_NAME_(item)* items, GEN_NAME_(removed)* removed, GEN_SIZE index) {
+    items[index].children[0] = removed->first;
+    if (removed->first == GEN_NONE) removed->last = index;
+    removed->first = index;
+    removed->count++;
+}
+
+
+static void GEN_NAME_(removeAll)(GEN_NAME_(item)* items, GEN_NAME_(removed)* removed, GEN_SIZE link) {
+    if (link == 0) return;
+    GEN_SIZE index = link & ~TREE_RED;
+    GEN_NAME_(removeAll)(items, removed, items[index].children[0]);
+    GEN_NAME_(removeAll)(items, removed, items[index].children[1]);
+    GEN_NAME_(pushRemoved)(items, removed, index);
+}
+
+
+// Add the removed items of [other] to [removed] in O(1)
+static inline void GEN_NAME_(mergeRemoved)(GEN_NAME_(item)* items, GEN_NAME_(removed)* removed, GEN_NAME_(removed)* other) {
+    if (other->first == GEN_NONE) return;
+    items[other->last].children[0] = removed->first;
+    if (removed->first == GEN_NONE) removed->last = other->last;
+    removed->first = other->first;
+    removed->count += other->count;
+}
+
+
+static void GEN_NAME_(combine)(GEN_NAME_(task)* task);
+
+static void* GEN_NAME_(combineThread)(void* task) {
+    GEN_NAME_(combine)(task);
+    return NULL;
+}
+
+
+// Split [a] by the root of [b], combine the halves recursively (in parallel for large sub-trees) and join the results
+static void GEN_NAME_(combine)(GEN_NAME_(task)* task) {
+    GEN_NAME_(item)* items = task->items;
+    GEN_NAME_(sub) a = task->a, b = task->b;
+    if (b.link == 0) {
+        if (task->op == TREE_INTERSECT) {
+            GEN_NAME_(removeAll)(items, &task->removed, a.link);
+            task->result = b;
+        }
+        else task->result = a;
+        return;
+    }
+    if (a.link == 0) {
+        task->result = task->op == TREE_UNION ? b : a;
+        return;
+    }
+
+    GEN_SIZE index = b.link & ~TREE_RED;
+    const GEN_NAME_(item)* item = task->otherItems + index;
+    int height = b.height - !(b.link & TREE_RED);
+    GEN_NAME_(task) left = *task, right = *task;
+    left.threads = task->threads / 2;
+    right.threads = task->threads - left.threads;
+    left.b = (GEN_NAME_(sub)) { item->children[0], height };
+    right.b = (GEN_NAME_(sub)) { item->children[1], height };
+    left.removed = right.removed = (GEN_NAME_(removed)) { GEN_NONE, GEN_NONE, 0 };
+    GEN_SIZE found;
+    GEN_NAME_(splitSub)(items, a, GEN_KV_KEY(item->kv), &left.a, &right.a, &found);
+
+    if (task->threads > 1 && height >= TREE_PARALLEL_HEIGHT) {
+        pthread_t thread;
+        THROW_R(pthread_create(&thread, NULL, GEN_NAME_(combineThread), &left));
+        GEN_NAME_(combine)(&right);
+        THROW_R(pthread_join(thread, NULL));
+    }
+    else {
+        GEN_NAME_(combine)(&left);
+        GEN_NAME_(combine)(&right);
+    }
+
+    if (task->op == TREE_UNION) {
+        if (found != 0) GEN_NAME_(pushRemoved)(items, &task->removed, found);
+        task->result = GEN_NAME_(join)(items, left.result, index, right.result);
+    }
+    else if (task->op == TREE_INTERSECT && found != 0) {
+        task->result = GEN_NAME_(join)(items, left.result, found, right.result);
+    }
+    else {
+        if (found != 0) GEN_NAME_(pushRemoved)(items, &task->removed, found);
+        task->result = GEN_NAME_(join2)(items, left.result, right.result);
+    }
+    GEN_NAME_(mergeRemoved)(items, &task->removed, &left.removed);
+    GEN_NAME_(mergeRemoved)(items, &task->removed, &right.removed);
+}
+
+
+// Apply a set operation between a tree and a sub-tree
+static void GEN_NAME_(setOperation)(GEN_ALGO* tree, const GEN_NAME_(item)* otherItems, GEN_NAME_(sub) b, int op, int threads) {
+    GEN_SIZE root = tree->items[0].children[1];
+    GEN_NAME_(task) task = {
+        .items = tree->items,
+        .otherItems = otherItems,
+        .op = op,
+        .threads = threads,
+        .a = { root, GEN_NAME_(height)(tree->items, root) },
+        .b = b,
+        .removed = { GEN_NONE, GEN_NONE, 0 }
+    };
+    GEN_NAME_(combine)(&task);
+    tree->items[0].children[1] = task.result.link;
+    tree->length -= task.removed.count;
+    if (task.removed.first != GEN_NONE) {
+        tree->items[task.removed.last].children[0] = tree->reusable;
+        tree->reusable = task.removed.first;
+    }
+}
+
+
+// Grow a tree so that [n] items can be added without growing
+static void GEN_NAME_(reserve)(GEN_ALGO* tree, GEN_SIZE n) {
+    if (n > TREE_MAX_CAPACITY - 2 - tree->length) THROW_ERR("Capacity overflow : more than %ju items", (uintmax_t)(TREE_MAX_CAPACITY - 2));
+    GEN_SIZE capacity = tree->capacity;
+    while (tree->length + n + 2 > capacity) {
+        capacity = capacity > TREE_MAX_CAPACITY >> 1 ? TREE_MAX_CAPACITY : capacity << 1;
+    }
+    if (capacity != tree->capacity) {
+        tree->capacity = capacity;
+        tree->items = THROW_PN(realloc(tree->items, sizeof(GEN_NAME_(item)) * capacity), tree->items);
+    }
+}
+
+
+// Items to build a sub-tree from, in order, read from another tree if [other] is not NULL or from arrays otherwise
+typedef struct {
+    GEN_ALGO* other;
+    GEN_NAME(iter) iter;
+    GEN_KEY* keys;
+#ifndef GEN_NO_VALUE
+    GEN_TYPE* values;
+#endif
+    GEN_SIZE i;
+} GEN_NAME_(source);
+
+
+// Build a balanced sub-tree of [n] items outside of the tree (enough capacity must be reserved), the items at depth [redDepth] are red
+static GEN_SIZE GEN_NAME_(build)(GEN_ALGO* tree, GEN_NAME_(source)* source, GEN_SIZE n, int depth, int redDepth) {
+    if (n == 0) return 0;
+    GEN_SIZE left = GEN_NAME_(build)(tree, source, (n - 1) >> 1, depth + 1, redDepth);
+    tree->length++;
+    GEN_SIZE index;
+    if (tree->reusable != GEN_NONE) {
+        index = tree->reusable;
+        tree->reusable = tree->items[index].children[0];
+    }
+    else index = tree->length;
+    GEN_NAME_(item)* item = tree->items + index;
+    if (source->other != NULL) item->kv = *GEN_NAME(next)(source->other, &source->iter);
+    else {
+        GEN_KV_KEY(item->kv) = source->keys[source->i];
+#ifndef GEN_NO_VALUE
+        item->kv.value = source->values[source->i];
+#endif
+        source->i++;
+    }
+    item->children[0] = left;
+    item->children[1] = GEN_NAME_(build)(tree, source, n - 1 - ((n - 1) >> 1), depth + 1, redDepth);
+    GEN_NAME_(update)(tree->items, index);
+    return depth == redDepth ? index | TREE_RED : index;
+}
+
+
+// Build the items of a source in a tree and add them to the tree
+static void GEN_NAME_(buildUnion)(GEN_ALGO* tree, GEN_NAME_(source)* source, GEN_SIZE n, int threads) {
+    GEN_NAME_(reserve)(tree, n);
+    // Every path of a size-balanced tree has floor(log2(n)) or floor(log2(n)) + 1 items, so only the deepest items are red
+    int height = 0;
+    while (n >> height > 1) height++;
+    GEN_NAME_(sub) b = { GEN_NAME_(build)(tree, source, n, 0, height), height };
+    GEN_NAME_(setOperation)(tree, tree->items, b, TREE_UNION, threads);
+}
+
+
+void GEN_NAME(union)(GEN_ALGO* a, GEN_ALGO* b, int threads) {
+    if (a == b) return;
+    GEN_NAME_(source) source = { .other = b, .iter = GEN_NAME(iterAll)() };
+    GEN_NAME_(buildUnion)(a, &source, b->length, threads);
+}
+
+
+void GEN_NAME(intersect)(GEN_ALGO* a, GEN_ALGO* b, int threads) {
+    if (a == b) return;
+    GEN_SIZE root = b->items[0].children[1];
+    GEN_NAME_(sub) sub = { root, GEN_NAME_(height)(b->items, root) };
+    GEN_NAME_(setOperation)(a, b->items, sub, TREE_INTERSECT, threads);
+}
+
+
+void GEN_NAME(difference)(GEN_ALGO* a, GEN_ALGO* b, int threads) {
+    if (a == b) {
+        a->items[0].children[1] = 0;
+        a->length = 0;
+        a->reusable = GEN_NONE;
+        return;
+    }
+    GEN_SIZE root = b->items[0].children[1];
+    GEN_NAME_(sub) sub = { root, GEN_NAME_(height)(b->items, root) };
+    GEN_NAME_(setOperation)(a, b->items, sub, TREE_DIFFERENCE, threads);
+}
+
+
+#ifdef GEN_NO_VALUE
+void GEN_NAME(insertBatch)(GEN_ALGO* tree, GEN_KEY* keys, GEN_SIZE n, int threads) {
+    GEN_NAME_(source) source = { .other = NULL, .keys = keys, .i = 0 };
+#else
+void GEN_NAME(insertBatch)(GEN_ALGO* tree, GEN_KEY* keys, GEN_TYPE* values, GEN_SIZE n, int threads) {
+    GEN_NAME_(source) source = { .other = NULL, .keys = keys, .values = values, .i = 0 };
+#endif
+    GEN_NAME_(buildUnion)(tree, &source, n, threads);
+}
+
+
+#ifndef TREE_SIZE
+// Number of items in a sub-tree, at most [limit]
+static GEN_SIZE GEN_NAME_(countUpTo)(GEN_NAME_(item)* items, GEN_SIZE link, GEN_SIZE limit) {
+    if (link == 0 || limit == 0) return 0;
+    GEN_NAME_(item)* item = items + (link & ~TREE_RED);
+    GEN_SIZE count = GEN_NAME_(countUpTo)(items, item->children[0], limit);
+    if (count == limit) return limit;
+    return count + 1 + GEN_NAME_(countUpTo)(items, item->children[1], limit - count - 1);
+}
+#endif
+
+
+// Move a sub-tree to the end of the items of another tree with the same shape, the moved items become reusable
+static GEN_SIZE GEN_NAME_(move)(GEN_ALGO* src, GEN_ALGO* dest, GEN_SIZE link) {
+    if (link == 0) return 0;
+    GEN_SIZE index = link & ~TREE_RED;
+    GEN_NAME_(item)* item = src->items + index;
+    GEN_SIZE destIndex = ++dest->length;
+    GEN_NAME_(item)* destItem = dest->items + destIndex;
+    destItem->kv = item->kv;
+#ifdef TREE_SIZE
+    destItem->size = item->size;
+#endif
+    GEN_SIZE left = item->children[0], right = item->children[1];
+    item->children[0] = src->reusable;
+    src->reusable = index;
+    src->length--;
+    destItem->children[0] = GEN_NAME_(move)(src, dest, left);
+    destItem->children[1] = GEN_NAME_(move)(src, dest, right);
+    return destIndex | (link & TREE_RED);
+}
+
+
+void GEN_NAME(split)(GEN_ALGO* a, GEN_KEY key, GEN_ALGO* left, GEN_ALGO* right) {
+    GEN_NAME_(item)* items = a->items;
+    GEN_SIZE root = items[0].children[1];
+    GEN_NAME_(sub) l, r;
+    GEN_SIZE found;
+    GEN_NAME_(splitSub)(items, (GEN_NAME_(sub)) { root, GEN_NAME_(height)(items, root) }, key, &l, &r, &found);
+    if (found != 0) r = GEN_NAME_(join)(items, (GEN_NAME_(sub)) { 0, 0 }, found, r);
+
+    // Size of the smaller part
+#ifdef TREE_SIZE
+    GEN_SIZE leftCount = items[l.link & ~TREE_RED].size;
+    bool leftSmaller = leftCount <= a->length - leftCount;
+    GEN_SIZE count = leftSmaller ? leftCount : a->length - leftCount;
+#else
+    GEN_SIZE limit = 1, leftCount, rightCount;
+    while (true) {
+        leftCount = GEN_NAME_(countUpTo)(items, l.link, limit);
+        rightCount = GEN_NAME_(countUpTo)(items, r.link, limit);
+        if (leftCount < limit || rightCount < limit) break;
+        limit <<= 1;
+    }
+    bool leftSmaller = leftCount <= rightCount;
+    GEN_SIZE count = leftSmaller ? leftCount : rightCount;
+#endif
+
+    // Move the smaller part into a new tree
+    GEN_ALGO small = GEN_NAME(new)(count + 2);
+    small.items[0].children[1] = GEN_NAME_(move)(a, &small, leftSmaller ? l.link : r.link);
+    GEN_ALGO large = *a;
+    large.items[0].children[1] = leftSmaller ? r.link : l.link;
+    *(leftSmaller ? left : right) = small;
+    *(leftSmaller ? right : left) = large;
+}
+
+
 #endif
 
 // Undef parameters for later use
 #undef TREE_SIZE
 #undef TREE_STACK
 #undef TREE_RED
+#undef TREE_MAX_CAPACITY
+#undef TREE_PARALLEL_HEIGHT
+#undef TREE_UNION
+#undef TREE_INTERSECT
+#undef TREE_DIFFERENCE
 
 #include "generic_end.h"
\ No newline at end of file
@@ -1,12 +1,29 @@
 #ifndef TEST_COLLECTIONS_H
 #define TEST_COLLECTIONS_H
 
+#include "hash.h"
+
+#define GEN_TYPE int
+#include "list.h"
+
+#define GEN_SUFFIX 64
+#define GEN_TYPE char
+#define GEN_SIZE int64_t
+#include "list.h"
+
+#define GEN_SUFFIX 8
 #define GEN_TYPE int
+#define GEN_SIZE int8_t
 #include "list.h"
 
 #define GEN_TYPE int
 #include "queue.h"
 
+#define GEN_SUFFIX 64
+#define GEN_TYPE int
+#define GEN_SIZE uint64_t
+#include "queue.h"
+
 #define GEN_KEY int
 #define GEN_TYPE int
 #include "heap.h"
@@ -17,21 +34,303 @@
 #define HEAP_MODIFIABLE
 #include "heap.h"
 
+#define GEN_SUFFIX 64
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint64_t
+#define HEAP_MODIFIABLE
+#include "heap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "map.h"
+
+#define GEN_SUFFIX snap
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_SNAPSHOT
+#include "map.h"
+
+#define GEN_SUFFIX inc
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_INCREMENTAL
+#include "map.h"
+
+#define GEN_SUFFIX load
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_MAX_LOAD 1.5
+#include "map.h"
+
+// Fast range index, the bucket of a hash is not split in 2 when growing
+#define GEN_SUFFIX range
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_INDEX(hash, mask) ((uint64_t)(uint32_t)((hash) * 2654435761u) * ((uint64_t)(mask) + 1) >> 32)
+#include "map.h"
+
+#define GEN_SUFFIX small
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_INLINE 8
+#include "map.h"
+
+#define GEN_SUFFIX soa
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_SOA
+#define MAP_INLINE 4
+#define MAP_SNAPSHOT
+#include "map.h"
+
+// Value larger than a cache line
+typedef struct {
+    long data[16];
+} bigValue;
+
+#define GEN_SUFFIX big
+#define GEN_KEY int
+#define GEN_TYPE bigValue
+#include "map.h"
+
+#define GEN_SUFFIX bigsoa
+#define GEN_KEY int
+#define GEN_TYPE bigValue
+#define MAP_SOA
+#include "map.h"
+
+#define GEN_SUFFIX intset
+#define GEN_KEY int
+#define GEN_NO_VALUE
+#define MAP_HASH hash_u32
+#include "map.h"
+
+#define GEN_KEY int
+#include "filter.h"
+
+#define GEN_SUFFIX cuckoo
+#define GEN_KEY int
+#define FILTER_CUCKOO
+#include "filter.h"
+
+#define GEN_SUFFIX filtered
+#define GEN_KEY int
+#define FILTER_CUCKOO
+#include "filter.h"
+
+#define GEN_SUFFIX filtered
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_FILTER
+#include "map.h"
+
+// Coarse hash, keys with the same hash can not all be in a filter
+#define GEN_SUFFIX coarse
+#define GEN_KEY int
+#define MAP_HASH(key) ((key) / 100)
+#define FILTER_CUCKOO
+#include "filter.h"
+
+#define GEN_SUFFIX coarse
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_HASH(key) ((key) / 100)
+#define MAP_FILTER
+#include "map.h"
+
+#define GEN_SUFFIX hashed
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_HASH hash_u32
+#include "map.h"
+
+#define GEN_SUFFIX long
+#define GEN_KEY long
+#define GEN_TYPE int
+#include "map.h"
+
+#define GEN_SUFFIX longhashed
+#define GEN_KEY long
+#define GEN_TYPE int
+#define MAP_HASH hash_u64
+#include "map.h"
+
+#define GEN_SUFFIX 64
+#define GEN_KEY long
+#define GEN_TYPE int
+#define GEN_SIZE uint64_t
+#define MAP_HASH hash_u64
+#define MAP_HASH_TYPE uint64_t
+#include "map.h"
+
+#define GEN_SUFFIX 16
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint16_t
+#include "map.h"
+
+#define GEN_SUFFIX 8
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint8_t
+#define MAP_MAX_LOAD 1
+#include "map.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "cmap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "flatmap.h"
+
+#define GEN_SUFFIX 16
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint16_t
+#include "flatmap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "rhmap.h"
+
+#define GEN_SUFFIX 16
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint16_t
+#include "rhmap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "cuckoomap.h"
+
+#define GEN_SUFFIX 8
+#define GEN_KEY int
+#define GEN_NO_VALUE
+#define CUCKOOMAP_WAYS 8
+#include "cuckoomap.h"
+
+#define GEN_SUFFIX 16
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint16_t
+#include "cuckoomap.h"
+
+#define GEN_PREFIX map
+#define GEN_SUFFIX cuckoo
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "cuckoomap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#define FROZENMAP_MAP
+#include "frozenmap.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#define MAP_HASH hash_u32
+#include "lru.h"
+
+#define GEN_SUFFIX 16
 #define GEN_KEY int
 #define GEN_TYPE int
+#define GEN_SIZE uint16_t
+#define MAP_HASH hash_u32
+#include "lru.h"
+
+#include <string.h>
+
+#define GEN_SUFFIX str
+#define GEN_KEY const char*
+#define GEN_TYPE int
+#define GEN_EQUALS(a, b) (strcmp(a, b) == 0)
+#define MAP_HASH hash_string
+#include "map.h"
+
+#define GEN_SUFFIX strhash
+#define GEN_KEY const char*
+#define GEN_TYPE int
+#define GEN_EQUALS(a, b) (strcmp(a, b) == 0)
+#define MAP_HASH hash_string
+#define MAP_STORE_HASH
+#include "map.h"
+
+#define GEN_SUFFIX strsmall
+#define GEN_KEY const char*
+#define GEN_TYPE int
+#define GEN_EQUALS(a, b) (strcmp(a, b) == 0)
+#define MAP_HASH hash_string
+#define MAP_INLINE 4
 #include "map.h"
 
+#define GEN_SUFFIX strfiltered
+#define GEN_KEY const char*
+#define MAP_HASH hash_string
+#define FILTER_CUCKOO
+#include "filter.h"
+
+#define GEN_SUFFIX strfiltered
+#define GEN_KEY const char*
+#define GEN_TYPE int
+#define GEN_EQUALS(a, b) (strcmp(a, b) == 0)
+#define MAP_HASH hash_string
+#define MAP_FILTER
+#include "map.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#define TREE_SIZE
+#include "tree.h"
+
+#define GEN_SUFFIX 64
+#define GEN_KEY int
+#define GEN_TYPE int
+#define GEN_SIZE uint64_t
+#define TREE_SIZE
+#include "tree.h"
+
+#define GEN_SUFFIX 16
 #define GEN_KEY int
 #define GEN_TYPE int
+#define GEN_SIZE uint16_t
 #define TREE_SIZE
 #include "tree.h"
 
+#define GEN_SUFFIX set
+#define GEN_KEY int
+#define GEN_NO_VALUE
+#include "tree.h"
+
+#define GEN_KEY int
+#define GEN_TYPE int
+#include "btree.h"
+
+#define GEN_SUFFIX small
+#define GEN_KEY int
+#define GEN_NO_VALUE
+#define BTREE_NODE 4
+#include "btree.h"
+
+#define GEN_TYPE int
+#define GEN_KEY unsigned int
+#define SORT_KEY SORT_SIGNED
+#include "sort.h"
+
+#define GEN_SUFFIX 64
 #define GEN_TYPE int
 #define GEN_KEY unsigned int
+#define GEN_SIZE uint64_t
 #define SORT_KEY SORT_SIGNED
 #include "sort.h"
 
 #define GEN_TYPE int
 #include "search.h"
 
+#define GEN_SUFFIX 64
+#define GEN_TYPE int
+#define GEN_SIZE uint64_t
+#include "search.h"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 10000
+
+// Same operations on a B+tree and a red-black tree
+static void btree_test() {
+    srand(314);
+    btree test = btree_new(0);
+    tree expected = tree_new(1);
+    for (int i = 0; i < 100 * N; i++) {
+        int key = rand() % (10 * N);
+        if (rand() % 3 == 0) {
+            int* ref = btree_remove(&test, key);
+            int* expectedRef = tree_remove(&expected, key);
+            if ((ref == NULL) != (expectedRef == NULL) || (ref && *ref != *expectedRef)) THROW_ERR("Incorrect remove");
+        }
+        else if (rand() % 2 == 0) {
+            if (btree_setOrAdd(&test, key, i) != tree_setOrAdd(&expected, key, i)) THROW_ERR("Incorrect add");
+        }
+        else if (btree_tryAdd(&test, key, i) != tree_tryAdd(&expected, key, i)) THROW_ERR("Incorrect add");
+    }
+    if (test.length != expected.length) THROW_ERR("Incorrect length");
+    for (int key = 0; key < 10 * N; key++) {
+        if (btree_getOrDefault(&test, key, -1) != tree_getOrDefault(&expected, key, -1)) THROW_ERR("Incorrect value");
+    }
+
+    btree_iter iter = btree_iterAll();
+    tree_iter expectedIter = tree_iterAll();
+    btree_kv* item;
+    tree_kv* expectedItem;
+    while ((expectedItem = tree_nextAll(&expected, &expectedIter))) {
+        item = btree_nextAll(&test, &iter);
+        if (!item || item->key != expectedItem->key || item->value != expectedItem->value) THROW_ERR("Incorrect item");
+    }
+    if (btree_nextAll(&test, &iter)) THROW_ERR("Incorrect item");
+    for (int i = 0; i < 100; i++) {
+        int start = rand() % (10 * N);
+        int end = start + rand() % N;
+        iter = btree_iterBetween(&test, start, end);
+        expectedIter = tree_iterBetween(&expected, start, end);
+        while ((expectedItem = tree_nextBetween(&expected, start, end, &expectedIter))) {
+            item = btree_nextBetween(&test, start, end, &iter);
+            if (!item || item->key != expectedItem->key) THROW_ERR("Incorrect item");
+        }
+        if (btree_nextBetween(&test, start, end, &iter)) THROW_ERR("Incorrect item");
+    }
+
+    for (int key = 0; key < 10 * N; key++) {
+        tree_kv* ceil = tree_ceil(&expected, key);
+        btree_kv* btreeCeil = btree_ceil(&test, key);
+        if (ceil ? !btreeCeil || btreeCeil->key != ceil->key : btreeCeil != NULL) THROW_ERR("Incorrect ceil");
+        tree_kv* floor = tree_countBefore(&expected, key + 1) != 0 ? tree_floor(&expected, key) : NULL;
+        btree_kv* btreeFloor = btree_floor(&test, key);
+        if (floor ? !btreeFloor || btreeFloor->key != floor->key : btreeFloor != NULL) THROW_ERR("Incorrect floor");
+    }
+
+    btree_free(&test);
+    tree_free(&expected);
+}
+
+// Many splits and merges with small nodes
+static void btree_small_test() {
+    srand(314);
+    bool expected[N] = {};
+    int length = 0;
+    btree_small test = btree_new_small(0);
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < 20 * N; i++) {
+            int key = rand() % N;
+            if (k % 2 == 0 ? rand() % 3 == 0 : rand() % 3 != 0) {
+                if (btree_remove_small(&test, key) != expected[key]) THROW_ERR("Incorrect remove");
+                length -= expected[key];
+                expected[key] = false;
+            }
+            else {
+                if (btree_tryAdd_small(&test, key) == expected[key]) THROW_ERR("Incorrect add");
+                length += !expected[key];
+                expected[key] = true;
+            }
+        }
+        if (test.length != length) THROW_ERR("Incorrect length");
+        btree_iter_small iter = btree_iterAll_small();
+        int* item;
+        int key = -1;
+        while ((item = btree_nextAll_small(&test, &iter))) {
+            while (++key < *item) {
+                if (expected[key]) THROW_ERR("Missing item");
+            }
+            if (!expected[key]) THROW_ERR("Incorrect item");
+        }
+        while (++key < N) {
+            if (expected[key]) THROW_ERR("Missing item");
+        }
+        int floor = -1;
+        for (key = 0; key < N; key++) {
+            if (btree_contains_small(&test, key) != expected[key]) THROW_ERR("Incorrect contains");
+            if (expected[key]) floor = key;
+            int* btreeFloor = btree_floor_small(&test, key);
+            if (floor == -1 ? btreeFloor != NULL : !btreeFloor || *btreeFloor != floor) THROW_ERR("Incorrect floor");
+        }
+    }
+    for (int key = 0; key < N; key++) btree_remove_small(&test, key);
+    if (test.length != 0 || test.height != 0 || btree_ceil_small(&test, 0) || btree_floor_small(&test, N)) THROW_ERR("Incorrect length");
+    btree_free_small(&test);
+}
+
+// Random lookups and range scans in a B+tree and a red-black tree
+static void btree_benchmark() {
+    int n = 1 << 22;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    long sum = 0;
+    TIME("Red-black tree",
+        tree expected = tree_new(1);
+        for (int i = 0; i < n; i++) tree_tryAdd(&expected, keys[i], i);
+        for (int i = 0; i < n; i++) sum += tree_get(&expected, keys[i]);
+        for (int i = 0; i < n; i += 256) {
+            tree_iter expectedIter = tree_iterAfter(&expected, keys[i]);
+            tree_kv* expectedItem;
+            for (int j = 0; j < 256 && (expectedItem = tree_nextAll(&expected, &expectedIter)); j++) sum += expectedItem->value;
+        }
+        tree_free(&expected);
+    )
+    TIME("B+tree",
+        btree test = btree_new(1);
+        for (int i = 0; i < n; i++) btree_tryAdd(&test, keys[i], i);
+        for (int i = 0; i < n; i++) sum -= btree_get(&test, keys[i]);
+        for (int i = 0; i < n; i += 256) {
+            btree_iter iter = btree_iterAfter(&test, keys[i]);
+            btree_kv* item;
+            for (int j = 0; j < 256 && (item = btree_nextAll(&test, &iter)); j++) sum -= item->value;
+        }
+        btree_free(&test);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    free(keys);
+}
+
+int main() {
+    btree_benchmark();
+    btree_test();
+    btree_small_test();
+}
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 100000
+#define THREADS 8
+
+typedef struct {
+    cmap* map;
+    int thread;
+    int threads;
+    int* keys;
+} cmap_arg;
+
+static void* cmap_addKeys(void* p) {
+    cmap_arg* arg = p;
+    for (int i = arg->thread; i < N; i += arg->threads) {
+        if (!cmap_tryAdd(arg->map, arg->keys[i], i)) THROW_ERR("Key not added");
+    }
+    return NULL;
+}
+
+static void* cmap_removeKeys(void* p) {
+    cmap_arg* arg = p;
+    for (int i = arg->thread; i < N; i += arg->threads) {
+        int value = -1;
+        if (!cmap_remove(arg->map, arg->keys[i], &value)) THROW_ERR("Key not found");
+        if (value != i) THROW_ERR("Incorrect value");
+    }
+    return NULL;
+}
+
+static void cmap_run(void* (*func)(void*), cmap* map, int* keys, int threads) {
+    pthread_t ids[threads];
+    cmap_arg args[threads];
+    for (int i = 0; i < threads; i++) {
+        args[i] = (cmap_arg) { .map = map, .thread = i, .threads = threads, .keys = keys };
+        THROW_R(pthread_create(ids + i, NULL, func, args + i));
+    }
+    for (int i = 0; i < threads; i++) {
+        THROW_R(pthread_join(ids[i], NULL));
+    }
+}
+
+static void cmap_count(map_kv* item, void* arg) {
+    ((bool*)arg)[item->value] = true;
+}
+
+static void cmap_test() {
+    srand(314);
+    static int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = i * 7919 + rand() % 7919;
+    cmap test = cmap_new(16, 1);
+    cmap_run(cmap_addKeys, &test, keys, THREADS);
+    if (cmap_length(&test) != N) THROW_ERR("Incorrect length");
+
+    static bool found[N];
+    cmap_forEach(&test, cmap_count, found);
+    for (int i = 0; i < N; i++) {
+        if (!found[i]) THROW_ERR("Value not found");
+        if (!cmap_contains(&test, keys[i])) THROW_ERR("Key not found");
+        if (cmap_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (cmap_getOrDefault(&test, keys[i], -1) != i) THROW_ERR("Incorrect value");
+        cmap_handle handle;
+        if (*cmap_ref(&test, keys[i], &handle) != i) THROW_ERR("Incorrect ref");
+        cmap_release(handle);
+        bool added;
+        if (*cmap_refOrEmpty(&test, keys[i], &added, &handle) != i || added) THROW_ERR("Incorrect ref");
+        cmap_release(handle);
+        if (cmap_setOrAdd(&test, keys[i], i)) THROW_ERR("Key added");
+    }
+
+    cmap_run(cmap_removeKeys, &test, keys, THREADS);
+    if (cmap_length(&test) != 0) THROW_ERR("Incorrect length");
+    cmap_free(&test);
+}
+
+// Share of a fixed total number of operations, so that the time decreases if the map scales with threads
+static void* cmap_mixedOps(void* p) {
+    cmap_arg* arg = p;
+    unsigned int seed = arg->thread;
+    for (int i = arg->thread; i < 16 * N; i += arg->threads) {
+        int key = rand_r(&seed) % N;
+        if (i % 4 == 0) cmap_setOrAdd(arg->map, key, i);
+        else cmap_contains(arg->map, key);
+    }
+    return NULL;
+}
+
+static void cmap_benchmark(int threads) {
+    cmap test = cmap_new(64, 1);
+    cmap_run(cmap_mixedOps, &test, NULL, threads);
+    cmap_free(&test);
+}
+
+int main() {
+    TIME("Concurrent map benchmark (1 thread, same total operations)",
+        cmap_benchmark(1);
+    )
+    TIME("Concurrent map benchmark (2 threads, same total operations)",
+        cmap_benchmark(2);
+    )
+    TIME("Concurrent map benchmark (4 threads, same total operations)",
+        cmap_benchmark(4);
+    )
+    TIME("Concurrent map benchmark (8 threads, same total operations)",
+        cmap_benchmark(8);
+    )
+    cmap_test();
+}
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 10000
+
+static void cuckoomap_test() {
+    srand(314);
+    int keys[N];
+    cuckoomap test = cuckoomap_new(2);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (cuckoomap_contains(&test, keys[i]) || cuckoomap_ref(&test, keys[i]) != NULL) THROW_ERR("Key already in map");
+        cuckoomap_add(&test, keys[i], i);
+        keys[++i] = rand();
+        cuckoomap_setOrAdd(&test, keys[i], i);
+        keys[++i] = rand();
+        if (!cuckoomap_tryAdd(&test, keys[i], i)) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        bool added;
+        *cuckoomap_refOrEmpty(&test, keys[i], &added) = i;
+        if (!added) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        cuckoomap_refOrDefault(&test, keys[i], i, &added);
+        if (!added) THROW_ERR("Key not added");
+    }
+    if (test.length != N) THROW_ERR("Incorrect length");
+
+    bool found[N] = {};
+    cuckoomap_iter iter = cuckoomap_iterStart();
+    cuckoomap_kv* item;
+    while ((item = cuckoomap_iterNext(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        found[item->value] = true;
+    }
+    for (int i = 0; i < N; i++) {
+        if (!found[i]) THROW_ERR("Value not found");
+    }
+
+    for (int i = 0; i < N; i++) {
+        if (!cuckoomap_contains(&test, keys[i])) THROW_ERR("Key not found");
+        if (cuckoomap_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (cuckoomap_getOrDefault(&test, keys[i], 314) != i) THROW_ERR("Incorrect value");
+        if (*cuckoomap_ref(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+        bool added;
+        if (*cuckoomap_refOrEmpty(&test, keys[i], &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        if (*cuckoomap_refOrDefault(&test, keys[i], 314, &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        int* ref = cuckoomap_remove(&test, keys[i]);
+        if (!ref) THROW_ERR("Key not found");
+        if (*ref != i) THROW_ERR("Incorrect ref");
+        ref = cuckoomap_remove(&test, keys[i]);
+        if (ref) THROW_ERR("Key not removed");
+        if (i % 100 == 0 && !cuckoomap_contains(&test, keys[N - 1])) THROW_ERR("Key lost by removal");
+    }
+    if (test.length != 0) THROW_ERR("Incorrect length");
+
+    for (int i = 0; i < N; i++) { // Reuse removed slots
+        cuckoomap_add(&test, keys[i], i);
+        if (i >= 100 && !cuckoomap_remove(&test, keys[i - 100])) THROW_ERR("Key not found");
+    }
+    if (test.length != 100) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (cuckoomap_contains(&test, keys[i]) != (i >= N - 100)) THROW_ERR("Incorrect key");
+    }
+
+    cuckoomap_free(&test);
+
+    test = cuckoomap_new(0); // Fill buckets up to the maximum load
+    for (int i = 0; i < N; i++) {
+        cuckoomap_add(&test, keys[i], i);
+        if (test.length > test.capacity) THROW_ERR("Incorrect capacity");
+    }
+    for (int i = 0; i < N; i++) {
+        if (cuckoomap_getOrDefault(&test, keys[i], -1) != i) THROW_ERR("Incorrect value");
+    }
+    cuckoomap_free(&test);
+
+    cuckoomap_8 test8 = cuckoomap_new_8(N); // 8 slots per bucket of keys only, without growing
+    int mask = test8.mask;
+    for (int i = 0; i < N; i++) cuckoomap_add_8(&test8, keys[i]);
+    if (test8.mask != mask) THROW_ERR("Map grown");
+    if (test8.length != N) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (!cuckoomap_contains_8(&test8, keys[i])) THROW_ERR("Key not found");
+        if (i % 2 == 0 && !cuckoomap_remove_8(&test8, keys[i])) THROW_ERR("Key not found");
+    }
+    for (int i = 0; i < N; i++) {
+        if (cuckoomap_contains_8(&test8, keys[i]) != (i % 2 == 1)) THROW_ERR("Incorrect key");
+    }
+    cuckoomap_free_8(&test8);
+
+    map_cuckoo replaced = map_new_cuckoo(0); // Replacement for map
+    for (int i = 0; i < N; i++) map_add_cuckoo(&replaced, keys[i], i);
+    for (int i = 0; i < N; i++) {
+        if (map_get_cuckoo(&replaced, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    map_free_cuckoo(&replaced);
+}
+
+// Unsigned 16 bits sizes: slot indexes stop at 32768, so the map fails to grow past 8192 buckets
+static void cuckoomap_16_test() {
+    cuckoomap_16 test = cuckoomap_new_16(0);
+    for (int i = 0; i < 29000; i++) cuckoomap_add_16(&test, 3 * i, i);
+    if (test.mask != 8191) THROW_ERR("Incorrect buckets");
+    for (int i = 0; i < 29000; i++) {
+        if (cuckoomap_get_16(&test, 3 * i) != i) THROW_ERR("Incorrect value");
+        if (cuckoomap_contains_16(&test, 3 * i + 1)) THROW_ERR("Incorrect key");
+    }
+    cuckoomap_free_16(&test);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        cuckoomap_16 full = cuckoomap_new_16(0);
+        for (int i = 0; i < 65000; i++) cuckoomap_add_16(&full, i, i);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
+}
+
+// Random lookups in a large map (half of them missing), compared to [map] and [flatmap]
+
+static void cuckoomap_benchmark() {
+    srand(314);
+    int n = 7 << 19;
+    int* keys = malloc(sizeof(int) * n);
+    int* order = malloc(sizeof(int) * n);
+    map source = map_new(n);
+    flatmap flat = flatmap_new(1 << 23);
+    cuckoomap test = cuckoomap_new(0);
+    for (int i = 0; i < n; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd(&source, keys[i], i)) map_add(&source, keys[i] = -i - 1, i);
+        flatmap_add(&flat, keys[i], i);
+        cuckoomap_add(&test, keys[i], i);
+    }
+    printf("Cuckoo map load : %.3f\n", (double)test.length / ((test.mask + 1) * 4));
+    for (int i = 0; i < n; i++) order[i] = i % 2 == 0 ? keys[rand() % n] : rand() | 1 << 30;
+    long mapSum = 0, flatSum = 0, cuckooSum = 0;
+    TIME("Map lookups",
+        for (int i = 0; i < n; i++) mapSum += map_getOrDefault(&source, order[i], -1);
+    )
+    TIME("Flat map lookups",
+        for (int i = 0; i < n; i++) flatSum += flatmap_getOrDefault(&flat, order[i], -1);
+    )
+    TIME("Cuckoo map lookups",
+        for (int i = 0; i < n; i++) cuckooSum += cuckoomap_getOrDefault(&test, order[i], -1);
+    )
+    if (flatSum != mapSum || cuckooSum != mapSum) THROW_ERR("Incorrect value");
+    map_free(&source);
+    flatmap_free(&flat);
+
+    TIME("Cuckoo map adds and removes",
+        for (int i = 0; i < n; i++) {
+            cuckoomap_remove(&test, keys[i]);
+            cuckoomap_add(&test, keys[i], i);
+        }
+    )
+    cuckoomap_free(&test);
+    free(keys);
+    free(order);
+}
+
+int main() {
+    cuckoomap_benchmark();
+    cuckoomap_test();
+    cuckoomap_16_test();
+}
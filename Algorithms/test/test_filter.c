@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 100000
+
+static void filter_test() {
+    srand(314);
+    static int keys[N];
+    filter test = filter_new(N);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand() & ~1;
+        filter_add(&test, keys[i]);
+    }
+    for (int i = 0; i < N; i++) {
+        if (!filter_contains(&test, keys[i])) THROW_ERR("Key not found");
+    }
+    int falsePositives = 0;
+    for (int i = 0; i < N; i++) falsePositives += filter_contains(&test, rand() | 1);
+    if (falsePositives > N / 100) THROW_ERR("Too many false positives : %d", falsePositives);
+    filter_clear(&test);
+    if (filter_contains(&test, keys[0])) THROW_ERR("Key not removed");
+    filter_free(&test);
+}
+
+static void filter_cuckoo_test() {
+    srand(314);
+    static int keys[N];
+    filter_cuckoo test = filter_new_cuckoo(N);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand() & ~1;
+        if (!filter_add_cuckoo(&test, keys[i])) THROW_ERR("Key not added");
+    }
+    if (test.length != N) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (!filter_contains_cuckoo(&test, keys[i])) THROW_ERR("Key not found");
+    }
+    int falsePositives = 0;
+    for (int i = 0; i < N; i++) falsePositives += filter_contains_cuckoo(&test, rand() | 1);
+    if (falsePositives > N / 100) THROW_ERR("Too many false positives : %d", falsePositives);
+    for (int i = 0; i < N; i += 2) filter_remove_cuckoo(&test, keys[i]);
+    for (int i = 1; i < N; i += 2) {
+        if (!filter_contains_cuckoo(&test, keys[i])) THROW_ERR("Key not found");
+    }
+    falsePositives = 0;
+    for (int i = 0; i < N; i += 2) falsePositives += filter_contains_cuckoo(&test, keys[i]);
+    if (falsePositives > N / 100) THROW_ERR("Key not removed");
+    filter_free_cuckoo(&test);
+
+    // Add keys until the filter is full
+    test = filter_new_cuckoo(1000);
+    int added = 0;
+    while (filter_add_cuckoo(&test, keys[added])) added++;
+    if (added < 1000) THROW_ERR("Filter full too early : %d", added);
+    for (int i = 0; i < added; i++) {
+        if (!filter_contains_cuckoo(&test, keys[i])) THROW_ERR("Key not found");
+    }
+    filter_remove_cuckoo(&test, keys[0]);
+    if (!filter_add_cuckoo(&test, keys[added])) THROW_ERR("Key not added");
+    for (int i = 1; i <= added; i++) {
+        if (!filter_contains_cuckoo(&test, keys[i])) THROW_ERR("Key not found");
+    }
+    filter_free_cuckoo(&test);
+}
+
+static void filter_benchmark() {
+    srand(314);
+    int n = 1 << 22;
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    filter bloom = filter_new(n);
+    filter_cuckoo cuckoo = filter_new_cuckoo(n);
+    TIME("Bloom filter add",
+        for (int i = 0; i < n; i++) filter_add(&bloom, keys[i]);
+    )
+    TIME("Cuckoo filter add",
+        for (int i = 0; i < n; i++) filter_add_cuckoo(&cuckoo, keys[i]);
+    )
+    TIME("Bloom filter contains",
+        for (int i = 0; i < n; i++) filter_contains(&bloom, keys[i] ^ i);
+    )
+    TIME("Cuckoo filter contains",
+        for (int i = 0; i < n; i++) filter_contains_cuckoo(&cuckoo, keys[i] ^ i);
+    )
+    filter_free(&bloom);
+    filter_free_cuckoo(&cuckoo);
+    free(keys);
+}
+
+int main() {
+    filter_benchmark();
+    filter_test();
+    filter_cuckoo_test();
+}
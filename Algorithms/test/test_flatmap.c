@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 10000
+
+static void flatmap_test() {
+    srand(314);
+    int keys[N];
+    flatmap test = flatmap_new(2);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (flatmap_contains(&test, keys[i]) || flatmap_ref(&test, keys[i]) != NULL) THROW_ERR("Key already in map");
+        flatmap_add(&test, keys[i], i);
+        keys[++i] = rand();
+        flatmap_setOrAdd(&test, keys[i], i);
+        keys[++i] = rand();
+        if (!flatmap_tryAdd(&test, keys[i], i)) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        bool added;
+        *flatmap_refOrEmpty(&test, keys[i], &added) = i;
+        if (!added) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        flatmap_refOrDefault(&test, keys[i], i, &added);
+        if (!added) THROW_ERR("Key not added");
+    }
+    if (test.length != N) THROW_ERR("Incorrect length");
+
+    bool found[N] = {};
+    flatmap_iter iter = flatmap_iterStart();
+    flatmap_kv* item;
+    while ((item = flatmap_iterNext(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        found[item->value] = true;
+    }
+    for (int i = 0; i < N; i++) {
+        if (!found[i]) THROW_ERR("Value not found");
+    }
+
+    for (int i = 0; i < N; i++) {
+        if (!flatmap_contains(&test, keys[i])) THROW_ERR("Key not found");
+        if (flatmap_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (flatmap_getOrDefault(&test, keys[i], 314) != i) THROW_ERR("Incorrect value");
+        if (*flatmap_ref(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+        bool added;
+        if (*flatmap_refOrEmpty(&test, keys[i], &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        if (*flatmap_refOrDefault(&test, keys[i], 314, &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        int* ref = flatmap_remove(&test, keys[i]);
+        if (!ref) THROW_ERR("Key not found");
+        if (*ref != i) THROW_ERR("Incorrect ref");
+        ref = flatmap_remove(&test, keys[i]);
+        if (ref) THROW_ERR("Key not removed");
+    }
+    if (test.length != 0) THROW_ERR("Incorrect length");
+
+    for (int i = 0; i < N; i++) { // Reuse deleted slots
+        flatmap_add(&test, keys[i], i);
+        if (i >= 100 && !flatmap_remove(&test, keys[i - 100])) THROW_ERR("Key not found");
+    }
+    if (test.length != 100) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (flatmap_contains(&test, keys[i]) != (i >= N - 100)) THROW_ERR("Incorrect key");
+    }
+
+    flatmap_free(&test);
+}
+
+// Unsigned 16 bits sizes: the map fills 32768 slots, then fails to grow instead of wrapping the slot count
+static void flatmap_16_test() {
+    flatmap_16 test = flatmap_new_16(2);
+    for (int i = 0; i < 28672; i++) flatmap_add_16(&test, i, i);
+    if (test.mask != 32767) THROW_ERR("Incorrect slots");
+    for (int i = 0; i < 28672; i++) {
+        if (flatmap_get_16(&test, i) != i) THROW_ERR("Incorrect value");
+    }
+    if (flatmap_contains_16(&test, 28672)) THROW_ERR("Incorrect key");
+    flatmap_free_16(&test);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        flatmap_16 full = flatmap_new_16(2);
+        for (int i = 0; i < 1 << 16; i++) flatmap_add_16(&full, i, i);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
+}
+
+
+static void flatmap_benchmark() {
+    srand(314);
+    int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = rand();
+    for (int i = 0; i < 4000; i++) {
+        flatmap test = flatmap_new(1);
+        for (int j = 0; j < N; j++) {
+            flatmap_add(&test, keys[j], j);
+        }
+        for (int j = 0; j < N; j++) {
+            flatmap_contains(&test, keys[j]);
+        }
+        for (int j = 0; j < N; j++) {
+            flatmap_remove(&test, keys[j]);
+        }
+        flatmap_free(&test);
+    }
+}
+
+int main() {
+    TIME("Flat map benchmark",
+        flatmap_benchmark();
+    )
+    flatmap_test();
+    flatmap_16_test();
+}
\ No newline at end of file
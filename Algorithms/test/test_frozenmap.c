@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 10000
+
+static void frozenmap_test() {
+    srand(314);
+    int keys[N];
+    int values[N];
+    map source = map_new(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd(&source, keys[i], i)) map_add(&source, keys[i] = -i - 1, i);
+        values[i] = i;
+    }
+
+    frozenmap test = frozenmap_fromArrays(keys, values, N);
+    if (test.length != N) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (!frozenmap_contains(&test, keys[i])) THROW_ERR("Key not found");
+        if (frozenmap_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (*frozenmap_ref(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+    }
+    for (int i = 0; i < N; i++) {
+        int key = rand();
+        if (frozenmap_contains(&test, key) != map_contains(&source, key)) THROW_ERR("Incorrect key");
+        if (frozenmap_getOrDefault(&test, key, -1) != map_getOrDefault(&source, key, -1)) THROW_ERR("Incorrect value");
+    }
+    bool found[N] = {};
+    frozenmap_iter iter = frozenmap_iterStart();
+    frozenmap_kv* item;
+    while ((item = frozenmap_iterNext(&test, &iter))) {
+        if (item->key != keys[item->value] || found[item->value]) THROW_ERR("Incorrect key");
+        found[item->value] = true;
+    }
+    for (int i = 0; i < N; i++) {
+        if (!found[i]) THROW_ERR("Value not found");
+    }
+    frozenmap_free(&test);
+
+    for (int i = 0; i < N; i += 2) map_remove(&source, keys[i]);
+    test = frozenmap_fromMap(&source);
+    if (test.length != N / 2) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (frozenmap_getOrDefault(&test, keys[i], -1) != (i % 2 == 0 ? -1 : i)) THROW_ERR("Incorrect value");
+    }
+    frozenmap_free(&test);
+    map_free(&source);
+
+    test = frozenmap_fromArrays(keys, values, 0);
+    if (frozenmap_contains(&test, keys[0]) || frozenmap_ref(&test, keys[0])) THROW_ERR("Key found");
+    frozenmap_free(&test);
+}
+
+// Build a large map then look up all keys in random order, compared to [map]
+static void frozenmap_benchmark() {
+    int n = 1 << 22;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    int* values = malloc(sizeof(int) * n);
+    map source = map_new(n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd(&source, keys[i], i)) map_add(&source, keys[i] = -i - 1, i);
+        values[i] = i;
+    }
+    int* order = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) order[i] = keys[rand() % n];
+    long sum = 0;
+    TIME("Map lookups",
+        for (int i = 0; i < n; i++) sum += map_get(&source, order[i]);
+    )
+    frozenmap test;
+    TIME("Frozen map build",
+        test = frozenmap_fromArrays(keys, values, n);
+    )
+    TIME("Frozen map lookups",
+        for (int i = 0; i < n; i++) sum -= frozenmap_get(&test, order[i]);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    printf("Memory per item : map %ld bytes, frozen map %.2f bytes\n",
+        (long)(sizeof(map_kv) + sizeof(int)) + (long)sizeof(int) * (source.mask + 1) / source.capacity,
+        (sizeof(frozenmap_kv) * (double)test.length + sizeof(uint16_t) * (double)test.buckets
+            + sizeof(int) * (double)(test.slots - test.length)) / test.length);
+    frozenmap_free(&test);
+    map_free(&source);
+    free(keys);
+    free(values);
+    free(order);
+}
+
+int main() {
+    frozenmap_benchmark();
+    frozenmap_test();
+}
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 1000000
+#define HISTOGRAM 8
+
+// Print the number of buckets for each chain length of a map built from the given keys, and time lookups
+#define MAP_HISTOGRAM(name, suffix, keys) { \
+    map##suffix test = map_new##suffix(1); \
+    for (int i = 0; i < N; i++) map_add##suffix(&test, keys[i], i); \
+    long histogram[HISTOGRAM + 1] = {}; \
+    int maxLength = 0; \
+    for (int i = 0; i <= test.mask; i++) { \
+        int length = 0; \
+        for (int index = test.buckets[i]; index != -1; index = test.items[index].next) length++; \
+        histogram[length < HISTOGRAM ? length : HISTOGRAM]++; \
+        if (length > maxLength) maxLength = length; \
+    } \
+    printf(name" chain lengths :"); \
+    for (int i = 0; i < HISTOGRAM; i++) printf(" %d:%ld", i, histogram[i]); \
+    printf(" %d+:%ld (max %d)\n", HISTOGRAM, histogram[HISTOGRAM], maxLength); \
+    TIME(name" lookups", \
+        for (int i = 0; i < N; i++) { \
+            if (map_get##suffix(&test, keys[i]) != i) THROW_ERR("Incorrect value"); \
+        } \
+    ) \
+    map_free##suffix(&test); \
+}
+
+static void hash_benchmark() {
+    // Multiples of a power of 2
+    int* ints = malloc(sizeof(int) * N);
+    for (int i = 0; i < N; i++) ints[i] = i << 11;
+    MAP_HISTOGRAM("Identity hash, multiples of 2048", , ints)
+    MAP_HISTOGRAM("hash_u32, multiples of 2048", _hashed, ints)
+    free(ints);
+
+    // Pointers to 64-byte objects
+    long* pointers = malloc(sizeof(long) * N);
+    for (int i = 0; i < N; i++) pointers[i] = 0x7f0000000000l + ((long)i << 6);
+    MAP_HISTOGRAM("Identity hash, pointers", _long, pointers)
+    MAP_HISTOGRAM("hash_u64, pointers", _longhashed, pointers)
+    free(pointers);
+}
+
+static void hash_test() {
+    // Small changes in the input change the hash
+    if (hash_u32(1) == hash_u32(2) || hash_u32(0) == hash_u32(1u << 31)) THROW_ERR("Hash collision");
+    if (hash_u64(1) == hash_u64(2) || hash_u64(0) == hash_u64(1ull << 63)) THROW_ERR("Hash collision");
+    if (hash_crc32(1) == hash_crc32(2)) THROW_ERR("Hash collision");
+
+    // Every length and every byte of a buffer is used
+    char buffer[64] = {};
+    uint64_t hashes[65];
+    for (int n = 0; n <= 64; n++) {
+        hashes[n] = hash_bytes(buffer, n, 0);
+        for (int i = 0; i < n; i++) {
+            if (hash_bytes(buffer, n, 0) != hashes[n]) THROW_ERR("Hash not deterministic");
+            buffer[i] = 1;
+            if (hash_bytes(buffer, n, 0) == hashes[n]) THROW_ERR("Byte %d not used with length %d", i, n);
+            buffer[i] = 0;
+        }
+        for (int i = 0; i < n; i++) {
+            if (hashes[i] == hashes[n]) THROW_ERR("Hash collision for lengths %d and %d", i, n);
+        }
+    }
+    if (hash_bytes(buffer, 16, 0) == hash_bytes(buffer, 16, 1)) THROW_ERR("Seed not used");
+    if (hash_string("hash") != hash_bytes("hash", 4, 0)) THROW_ERR("Incorrect string hash");
+}
+
+int main() {
+    hash_benchmark();
+    hash_test();
+}
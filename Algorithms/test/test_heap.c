@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "./algorithms.h"
 #include "benchmark.h"
+#include "throw.h"
 
 #define MAX_LENGTH 1048576
 
@@ -63,10 +64,40 @@ static void heap_mod_test() {
     printf("%ld\n", h);
 }
 
+// Same operations with 32 and unsigned 64 bits sizes
+static void heap_64_test() {
+    srand(314);
+    heap_mod test = heap_new_mod(1);
+    heap_64 test64 = heap_new_64(0);
+    int32_t indices[10000];
+    uint64_t indices64[10000];
+    for (int i = 0; i < 10000; i++) {
+        int key = rand();
+        indices[i] = heap_add_mod(&test, key, i);
+        indices64[i] = heap_add_64(&test64, key, i);
+    }
+    for (int i = 0; i < 5000; i++) {
+        int key = rand();
+        heap_changeKey_mod(&test, indices[i], key);
+        heap_changeKey_64(&test64, indices64[i], key);
+        heap_remove_mod(&test, indices[5000 + i]);
+        heap_remove_64(&test64, indices64[5000 + i]);
+    }
+    while (test.length > 0) {
+        heap_kv_mod item = heap_pop_mod(&test);
+        heap_kv_64 item64 = heap_pop_64(&test64);
+        if (item.key != item64.key || item.value != item64.value) THROW_ERR("Incorrect item");
+    }
+    if (test64.length != 0) THROW_ERR("Incorrect length");
+    heap_free_mod(&test);
+    heap_free_64(&test64);
+}
+
 int main() {
     TIME("Heap benchmark", 
         heap_benchmark();
     )
     heap_test();
     heap_mod_test();
+    heap_64_test();
 }
\ No newline at end of file
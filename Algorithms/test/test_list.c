@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "./algorithms.h"
 #include "benchmark.h"
+#include "throw.h"
 
 #define MAX_LENGTH 1048576
 
@@ -35,9 +36,36 @@ static void listest() {
     printf("%ld\n", h);
 }
 
+// A list with 8 bits sizes grows up to the largest size instead of overflowing
+static void list_8_test() {
+    list_8 test = list_new_8(0);
+    for (int i = 0; i < INT8_MAX; i++) list_add_8(&test, i);
+    if (test.length != INT8_MAX || test.capacity != INT8_MAX) THROW_ERR("Incorrect capacity");
+    for (int i = INT8_MAX; i-- > 0;) {
+        if (list_pop_8(&test) != i) THROW_ERR("Incorrect value");
+    }
+    list_free_8(&test);
+}
+
+// Indexes past 2^31 that 32 bits sizes can not hold, only the last pages of the list are touched
+static void list_64_test() {
+    int64_t n = ((int64_t)1 << 31) + (1 << 20);
+    list_64 test = list_new_64(n);
+    test.length = n - 2; // Values before are never read
+    list_add_64(&test, 1);
+    list_add_64(&test, 2);
+    if (test.length != n || test.capacity != n) THROW_ERR("Incorrect capacity");
+    if (test.values[n - 1] != 2 || test.values[n - 2] != 1) THROW_ERR("Incorrect value");
+    if (list_pop_64(&test) != 2 || list_pop_64(&test) != 1) THROW_ERR("Incorrect value");
+    if (test.length != n - 2) THROW_ERR("Incorrect length");
+    list_free_64(&test);
+}
+
 int main() {
     TIME("List benchmark", 
         list_benchmark();
     )
     listest();
+    list_8_test();
+    list_64_test();
 }
\ No newline at end of file
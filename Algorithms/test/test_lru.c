@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <math.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 100000
+#define CAPACITY 100
+
+static void lru_count(lru_kv* item, void* arg) {
+    int* evicted = arg;
+    evicted[item->key] = item->value;
+}
+
+static void lru_test() {
+    srand(314);
+    static int evicted[N];
+    for (int i = 0; i < N; i++) evicted[i] = -1;
+    // Keys from the most to the least recently used one
+    int order[CAPACITY + 1];
+    int length = 0;
+    lru test = lru_new(CAPACITY, lru_count, evicted);
+    for (int i = 0; i < N; i++) {
+        int key = rand() % (CAPACITY * 2);
+        int found = 0;
+        while (found < length && order[found] != key) found++;
+        int op = rand() % 4;
+        if (op == 0) {
+            if ((lru_remove(&test, key) != NULL) != (found < length)) THROW_ERR("Incorrect remove");
+            if (found < length) {
+                for (int j = found; j < length - 1; j++) order[j] = order[j + 1];
+                length--;
+            }
+            continue;
+        }
+        if (op == 1) {
+            if (lru_contains(&test, key) != (found < length)) THROW_ERR("Incorrect contains");
+            continue;
+        }
+        if (op == 2) {
+            int* value = lru_ref(&test, key);
+            if ((value != NULL) != (found < length)) THROW_ERR("Incorrect ref");
+            if (value && *value != key + 1) THROW_ERR("Incorrect value");
+            if (found == length) continue;
+        }
+        else {
+            if (lru_put(&test, key, key + 1) != (found == length)) THROW_ERR("Incorrect put");
+            if (found == length) {
+                if (length == CAPACITY) {
+                    int oldest = order[--length];
+                    if (evicted[oldest] != oldest + 1) THROW_ERR("Item not evicted");
+                    evicted[oldest] = -1;
+                }
+                length++;
+            }
+        }
+        for (int j = (found < length ? found : length - 1); j > 0; j--) order[j] = order[j - 1];
+        order[0] = key;
+        if (test.length != length) THROW_ERR("Incorrect length");
+    }
+
+    lru_iter iter = lru_iterStart(&test);
+    lru_kv* item;
+    int count = 0;
+    while ((item = lru_iterNext(&test, &iter))) {
+        if (item->key != order[count++]) THROW_ERR("Incorrect order");
+    }
+    if (count != length) THROW_ERR("Incorrect length");
+    lru_free(&test);
+}
+
+// Unsigned 16 bits sizes: the largest cache has 16384 items, as it needs twice as many buckets (at most 32768)
+static void lru_16_test() {
+    lru_16 test = lru_new_16(16384, NULL, NULL);
+    for (int i = 0; i < 40000; i++) lru_put_16(&test, i, i + 1);
+    if (test.length != 16384) THROW_ERR("Incorrect length");
+    for (int i = 0; i < 40000; i++) {
+        if (lru_contains_16(&test, i) != (i >= 40000 - 16384)) THROW_ERR("Incorrect key");
+    }
+    lru_free_16(&test);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        lru_new_16(40000, NULL, NULL);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
+}
+
+
+// Keys following a Zipf distribution with exponent s on [0, n)
+static int* lru_zipfKeys(int n, double s, int count) {
+    double* cdf = malloc(sizeof(double) * n);
+    double sum = 0;
+    for (int i = 0; i < n; i++) cdf[i] = sum += 1 / pow(i + 1, s);
+    int* keys = malloc(sizeof(int) * count);
+    for (int i = 0; i < count; i++) {
+        double x = (double)rand() / RAND_MAX * sum;
+        int start = 0, end = n - 1;
+        while (start < end) {
+            int middle = (start + end) >> 1;
+            if (cdf[middle] < x) start = middle + 1;
+            else end = middle;
+        }
+        // Spread the popular keys in the key space
+        keys[i] = start * 2654435761u;
+    }
+    free(cdf);
+    return keys;
+}
+
+// Cache a Zipf key stream with different cache sizes
+static void lru_benchmark() {
+    srand(314);
+    int count = 1 << 24;
+    int* keys = lru_zipfKeys(1 << 20, 0.99, count);
+    for (int capacity = 1 << 10; capacity <= 1 << 18; capacity <<= 4) {
+        lru test = lru_new(capacity, NULL, NULL);
+        int hits = 0;
+        gettimeofday(&_t1, NULL);
+        for (int i = 0; i < count; i++) {
+            int* value = lru_ref(&test, keys[i]);
+            if (value) hits++;
+            else lru_put(&test, keys[i], i);
+        }
+        gettimeofday(&_t2, NULL);
+        long time = (_t2.tv_sec - _t1.tv_sec) * 1000000 + (_t2.tv_usec - _t1.tv_usec);
+        printf("LRU capacity %d : hit rate %.1f%%, %.1f M accesses/s\n",
+            capacity, 100.0 * hits / count, (double)count / time);
+        lru_free(&test);
+    }
+    free(keys);
+}
+
+int main() {
+    lru_benchmark();
+    lru_test();
+    lru_16_test();
+}
@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "./algorithms.h"
 #include "benchmark.h"
 #include "throw.h"
@@ -40,6 +42,16 @@ static void map_test() {
         if (!found[i]) THROW_ERR("Value not found");
     }
 
+    int* refs[N];
+    map_refBatch(&test, keys, N, refs);
+    map_containsBatch(&test, keys, N, found);
+    for (int i = 0; i < N; i++) {
+        if (!found[i] || !refs[i] || *refs[i] != i) THROW_ERR("Incorrect batch ref");
+    }
+    int missing[] = { -1, -2, -3 };
+    map_containsBatch(&test, missing, 3, found);
+    if (found[0] || found[1] || found[2]) THROW_ERR("Key found");
+
     for (int i = 0; i < N; i++) {
         if (!map_contains(&test, keys[i])) THROW_ERR("Key not found");
         if (map_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
@@ -58,7 +70,483 @@ static void map_test() {
     }
     if (test.length != 0) THROW_ERR("Incorrect length");
 
+    for (int i = 0; i < N; i++) map_add(&test, keys[i], i);
+    for (int i = 0; i < N; i += 2) map_remove(&test, keys[i]);
+    map_compact(&test);
+    if (test.end != N / 2) THROW_ERR("Items not compacted");
+    int count = 0;
+    iter = map_iterStart();
+    while ((item = map_iterNext(&test, &iter))) {
+        if (item->value % 2 == 0 || item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        count++;
+    }
+    if (count != N / 2) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (map_contains(&test, keys[i]) != (i % 2 == 1)) THROW_ERR("Incorrect key");
+    }
+
+    for (int i = 0; i < N; i += 4) map_remove(&test, keys[i + 1]);
+    map_shrinkToFit(&test);
+    if (test.capacity < test.length || test.capacity >= test.length * 2) THROW_ERR("Incorrect capacity");
+    for (int i = 0; i < N; i++) {
+        if (map_contains(&test, keys[i]) != (i % 4 == 3)) THROW_ERR("Incorrect key");
+    }
+    map_reserve(&test, 4 * N);
+    int mask = test.mask;
+    for (int i = 0; i < N; i += 4) map_add(&test, keys[i], i);
+    if (test.mask != mask) THROW_ERR("Map grown after reserve");
+    for (int i = 0; i < N; i++) {
+        if (map_contains(&test, keys[i]) != (i % 4 == 0 || i % 4 == 3)) THROW_ERR("Incorrect key");
+    }
+
+    map_free(&test);
+}
+
+static void map_fromArrays_test() {
+    srand(314);
+    int keys[N];
+    int values[N];
+    map test = map_new(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd(&test, keys[i], i)) keys[i] = -i - 1;
+        values[i] = i;
+    }
+    map_free(&test);
+    test = map_fromArrays(keys, values, N);
+    if (test.length != N) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (map_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    for (int i = 0; i < N; i += 2) map_remove(&test, keys[i]);
+    for (int i = 0; i < N; i += 2) map_add(&test, keys[i], -i);
+    for (int i = 0; i < N; i++) {
+        if (map_get(&test, keys[i]) != (i % 2 == 0 ? -i : i)) THROW_ERR("Incorrect value");
+    }
     map_free(&test);
+    test = map_fromArrays(keys, values, 0);
+    if (test.length != 0 || map_contains(&test, keys[0])) THROW_ERR("Incorrect length");
+    map_free(&test);
+}
+
+static void map_snapshot_test() {
+    srand(314);
+    int keys[N];
+    map_snap test = map_new_snap(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        map_add_snap(&test, keys[i], i);
+    }
+    for (int i = 0; i < N; i += 3) map_remove_snap(&test, keys[i]);
+    char path[] = "/tmp/test_mapXXXXXX";
+    THROW_P(int fd = mkstemp(path), fd < 0);
+    map_save_snap(&test, fd);
+    THROW(close(fd));
+
+    map_snap mapped = map_mmap_snap(path);
+    THROW(unlink(path));
+    if (mapped.length != test.length) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (map_contains_snap(&mapped, keys[i]) != (i % 3 != 0)) THROW_ERR("Incorrect key");
+        if (i % 3 != 0 && map_get_snap(&mapped, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    int count = 0;
+    map_iter_snap iter = map_iterStart_snap();
+    map_kv_snap* item;
+    while ((item = map_iterNext_snap(&mapped, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        count++;
+    }
+    if (count != test.length) THROW_ERR("Incorrect length");
+    map_munmap_snap(&mapped);
+    map_free_snap(&test);
+}
+
+static void map_inc_test() {
+    srand(314);
+    int keys[N];
+    map_inc test = map_new_inc(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd_inc(&test, keys[i], i)) THROW_ERR("Key not added");
+        if (map_get_inc(&test, keys[i >> 1]) != i >> 1) THROW_ERR("Incorrect value");
+        if (i == N / 2) map_reserve_inc(&test, N);
+    }
+    if (test.length != N) THROW_ERR("Incorrect length");
+
+    int count = 0;
+    map_iter_inc iter = map_iterStart_inc();
+    map_kv_inc* item;
+    while ((item = map_iterNext_inc(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        count++;
+    }
+    if (count != N) THROW_ERR("Incorrect length");
+
+    for (int i = 0; i < N; i++) {
+        if (*map_remove_inc(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+        if (map_contains_inc(&test, keys[i])) THROW_ERR("Key not removed");
+    }
+    if (test.length != 0) THROW_ERR("Incorrect length");
+
+    map_free_inc(&test);
+}
+
+static void map_load_test() {
+    srand(314);
+    int keys[N];
+    map_load test = map_new_load(3);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (!map_tryAdd_load(&test, keys[i], i)) THROW_ERR("Key not added");
+        if (test.capacity != (int)((test.mask + 1) * 1.5)) THROW_ERR("Incorrect capacity");
+    }
+    for (int i = 0; i < N; i++) {
+        if (map_get_load(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (i % 3 != 0 && *map_remove_load(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+    }
+    map_shrinkToFit_load(&test);
+    for (int i = 0; i < N; i++) {
+        if (map_contains_load(&test, keys[i]) != (i % 3 == 0)) THROW_ERR("Incorrect key");
+    }
+    map_free_load(&test);
+}
+
+// Custom index that does not keep items in the same bucket modulo the previous number of buckets
+static void map_range_test() {
+    map_range test = map_new_range(3);
+    for (int i = 0; i < N; i++) {
+        if (!map_tryAdd_range(&test, i, i)) THROW_ERR("Key not added");
+    }
+    for (int i = 0; i < N; i++) {
+        if (map_getOrDefault_range(&test, i, -1) != i) THROW_ERR("Incorrect value");
+        if (i % 3 != 0 && *map_remove_range(&test, i) != i) THROW_ERR("Incorrect ref");
+    }
+    map_shrinkToFit_range(&test);
+    for (int i = 0; i < 2 * N; i++) {
+        if (map_contains_range(&test, i) != (i < N && i % 3 == 0)) THROW_ERR("Incorrect key");
+    }
+    map_free_range(&test);
+}
+
+static void map_set_test() {
+    srand(314);
+    map_intset a = map_new_intset(0);
+    map_intset b = map_new_intset(0);
+    for (int i = 0; i < N; i++) map_tryAdd_intset(&a, rand() % (N * 2));
+    for (int i = 0; i < N / 3; i++) map_tryAdd_intset(&b, rand() % (N * 2));
+    map_remove_intset(&a, 0); // Reusable item in [a]
+    for (int k = 0; k < 2; k++) {
+        map_intset sets[3] = { map_union_intset(&a, &b), map_intersect_intset(&a, &b), map_difference_intset(&a, &b) };
+        int lengths[3] = {};
+        for (int i = 0; i < N * 2; i++) {
+            bool inA = map_contains_intset(&a, i), inB = map_contains_intset(&b, i);
+            bool expected[3] = { inA || inB, inA && inB, inA && !inB };
+            for (int j = 0; j < 3; j++) {
+                if (map_contains_intset(&sets[j], i) != expected[j]) THROW_ERR("Incorrect key");
+                lengths[j] += expected[j];
+            }
+        }
+        for (int j = 0; j < 3; j++) {
+            if (sets[j].length != lengths[j]) THROW_ERR("Incorrect length");
+        }
+        if (!map_isSubset_intset(&sets[1], &a) || !map_isSubset_intset(&sets[1], &b) || !map_isSubset_intset(&sets[2], &a)) {
+            THROW_ERR("Incorrect subset");
+        }
+        if (map_isSubset_intset(&a, &sets[2]) || map_isSubset_intset(&b, &sets[2]) || !map_isSubset_intset(&b, &sets[0])) {
+            THROW_ERR("Incorrect subset");
+        }
+        for (int j = 0; j < 3; j++) map_free_intset(&sets[j]);
+        map_intset tmp = a; // Smaller first set
+        a = b;
+        b = tmp;
+    }
+    map_intset empty = map_new_intset(0);
+    map_intset result = map_intersect_intset(&a, &empty);
+    if (result.length != 0 || !map_isSubset_intset(&empty, &a)) THROW_ERR("Incorrect empty set");
+    map_free_intset(&result);
+    map_free_intset(&empty);
+    map_free_intset(&a);
+    map_free_intset(&b);
+}
+
+static void map_filtered_test() {
+    srand(314);
+    int keys[N];
+    map_filtered test = map_new_filtered(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand() & ~1;
+        if (!map_tryAdd_filtered(&test, keys[i], i)) keys[i] = -2 * i - 2;
+        if (map_contains_filtered(&test, keys[i] | 1)) THROW_ERR("Key found");
+    }
+    bool found[N];
+    map_containsBatch_filtered(&test, keys, N, found);
+    for (int i = 0; i < N; i++) {
+        if (!found[i] || map_get_filtered(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    for (int i = 0; i < N; i += 2) {
+        if (*map_remove_filtered(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+        if (map_remove_filtered(&test, keys[i])) THROW_ERR("Key not removed");
+    }
+    map_shrinkToFit_filtered(&test);
+    for (int i = 0; i < N; i++) {
+        if (map_contains_filtered(&test, keys[i]) != (i % 2 == 1)) THROW_ERR("Incorrect key");
+    }
+    if (test.filter.length != test.length) THROW_ERR("Incorrect filter length");
+    map_free_filtered(&test);
+}
+
+// Filter disabled by too many keys with the same hash
+static void map_coarse_test() {
+    map_coarse test = map_new_coarse(1);
+    for (int i = 0; i < N; i++) {
+        if (!map_tryAdd_coarse(&test, i, i)) THROW_ERR("Key not added");
+    }
+    if (!test.unfiltered) THROW_ERR("Filter not disabled");
+    for (int i = 0; i < N; i++) {
+        if (map_get_coarse(&test, i) != i || map_contains_coarse(&test, N + i)) THROW_ERR("Incorrect key");
+    }
+    for (int i = 0; i < N; i++) {
+        if (i % 100 != 0 && *map_remove_coarse(&test, i) != i) THROW_ERR("Incorrect ref");
+    }
+    map_shrinkToFit_coarse(&test);
+    if (test.unfiltered) THROW_ERR("Filter not enabled");
+    for (int i = 0; i < N; i++) {
+        if (map_contains_coarse(&test, i) != (i % 100 == 0)) THROW_ERR("Incorrect key");
+    }
+    map_free_coarse(&test);
+}
+
+// Add, find and remove string keys
+#define MAP_STRING_TEST(suffix, keys, n, iterations) \
+    for (int i = 0; i < iterations; i++) { \
+        map##suffix test = map_new##suffix(1); \
+        for (int j = 0; j < n; j++) { \
+            if (!map_tryAdd##suffix(&test, keys[j], j)) THROW_ERR("Key not added"); \
+        } \
+        for (int j = 0; j < n; j++) { \
+            if (map_get##suffix(&test, keys[j]) != j) THROW_ERR("Incorrect value"); \
+        } \
+        for (int j = 0; j < n; j++) { \
+            if (*map_remove##suffix(&test, keys[j]) != j) THROW_ERR("Incorrect ref"); \
+        } \
+        if (test.length != 0) THROW_ERR("Incorrect length"); \
+        map_free##suffix(&test); \
+    }
+
+static char** map_stringKeys() {
+    char** keys = malloc(sizeof(char*) * N);
+    for (int i = 0; i < N; i++) {
+        keys[i] = malloc(64);
+        snprintf(keys[i], 64, "a rather long key with a common prefix %d", i);
+    }
+    return keys;
+}
+
+static void map_inline_test() {
+    srand(314);
+    int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = rand();
+    map_small test = map_new_small(0);
+    for (int i = 0; i < 8; i++) {
+        if (!map_tryAdd_small(&test, keys[i], i)) THROW_ERR("Key not added");
+        if (map_tryAdd_small(&test, keys[i], i)) THROW_ERR("Key added twice");
+    }
+    if (test.buckets != NULL) THROW_ERR("Items not inline");
+    for (int i = 0; i < N; i++) {
+        if (map_getOrDefault_small(&test, keys[i], -1) != (i < 8 ? i : -1)) THROW_ERR("Incorrect value");
+    }
+    int* ref = map_remove_small(&test, keys[2]);
+    if (!ref || *ref != 2 || map_contains_small(&test, keys[2])) THROW_ERR("Key not removed");
+    map_add_small(&test, keys[2], 2);
+    bool found[N];
+    map_containsBatch_small(&test, keys, N, found);
+    for (int i = 0; i < N; i++) {
+        if (found[i] != (i < 8)) THROW_ERR("Incorrect batch");
+    }
+
+    for (int i = 8; i < N; i++) map_add_small(&test, keys[i], i); // Move to buckets
+    if (test.buckets == NULL || test.length != N) THROW_ERR("Items not moved");
+    for (int i = 0; i < N; i++) {
+        if (map_get_small(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    for (int i = 6; i < N; i++) map_remove_small(&test, keys[i]);
+    map_shrinkToFit_small(&test); // Move back inline
+    if (test.buckets != NULL || test.length != 6) THROW_ERR("Items not moved back");
+    map_iter_small iter = map_iterStart_small();
+    map_kv_small* item;
+    int count = 0;
+    while ((item = map_iterNext_small(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        count++;
+    }
+    if (count != 6) THROW_ERR("Incorrect length");
+    map_reserve_small(&test, 100);
+    if (test.buckets == NULL || test.capacity < 100) THROW_ERR("Map not reserved");
+    for (int i = 0; i < 6; i++) {
+        if (map_get_small(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+    }
+    map_free_small(&test);
+
+    int values[N];
+    for (int i = 0; i < N; i++) values[i] = i;
+    test = map_fromArrays_small(keys, values, 5);
+    if (test.buckets != NULL || map_get_small(&test, keys[4]) != 4) THROW_ERR("Incorrect value");
+    map_free_small(&test);
+
+    char** strings = map_stringKeys();
+    MAP_STRING_TEST(_strsmall, strings, 4, 10)
+    MAP_STRING_TEST(_strsmall, strings, N, 10)
+    for (int i = 0; i < N; i++) free(strings[i]);
+    free(strings);
+}
+
+static void map_soa_test() {
+    srand(314);
+    int keys[N];
+    map_soa test = map_new_soa(0);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        map_add_soa(&test, keys[i], i);
+        if (i == 3 && test.buckets != NULL) THROW_ERR("Items not inline");
+    }
+    for (int i = 0; i < N; i += 3) {
+        int* ref = map_remove_soa(&test, keys[i]);
+        if (!ref || *ref != i) THROW_ERR("Incorrect removed value");
+    }
+    for (int i = 0; i < N; i++) {
+        if (map_getOrDefault_soa(&test, keys[i], -1) != (i % 3 != 0 ? i : -1)) THROW_ERR("Incorrect value");
+    }
+
+    // Values modified while iterating
+    map_iter_soa iter = map_iterStart_soa();
+    map_kv_soa* item;
+    int count = 0;
+    while ((item = map_iterNext_soa(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        *map_iterValue_soa(&test, &iter) = -item->value;
+        count++;
+    }
+    if (count != test.length) THROW_ERR("Incorrect length");
+
+    char path[] = "/tmp/test_mapXXXXXX";
+    THROW_P(int fd = mkstemp(path), fd < 0);
+    map_save_soa(&test, fd);
+    THROW(close(fd));
+    map_soa mapped = map_mmap_soa(path);
+    THROW(unlink(path));
+    map_compact_soa(&test);
+    for (int i = 0; i < N; i++) {
+        if (map_getOrDefault_soa(&test, keys[i], 1) != (i % 3 != 0 ? -i : 1)) THROW_ERR("Incorrect value");
+        if (map_getOrDefault_soa(&mapped, keys[i], 1) != (i % 3 != 0 ? -i : 1)) THROW_ERR("Incorrect mapped value");
+    }
+    map_munmap_soa(&mapped);
+
+    for (int i = 0; i < N; i++) map_remove_soa(&test, keys[i]);
+    for (int i = 0; i < 3; i++) map_add_soa(&test, keys[i], i);
+    map_shrinkToFit_soa(&test); // Move back inline
+    if (test.buckets != NULL || test.length != 3) THROW_ERR("Items not moved back");
+    char inlinePath[] = "/tmp/test_mapXXXXXX"; // Saved from a copy in buckets
+    THROW_P(fd = mkstemp(inlinePath), fd < 0);
+    map_save_soa(&test, fd);
+    THROW(close(fd));
+    if (test.buckets != NULL) THROW_ERR("Saved map modified");
+    mapped = map_mmap_soa(inlinePath);
+    THROW(unlink(inlinePath));
+    for (int i = 0; i < 3; i++) {
+        if (map_getOrDefault_soa(&mapped, keys[i], -1) != i) THROW_ERR("Incorrect mapped value");
+    }
+    map_munmap_soa(&mapped);
+    map_remove_soa(&test, keys[0]);
+    for (int i = 0; i < 3; i++) {
+        if (map_getOrDefault_soa(&test, keys[i], -1) != (i > 0 ? i : -1)) THROW_ERR("Incorrect value");
+    }
+    map_free_soa(&test);
+}
+
+// Unsigned 64 bits sizes and hashes, with reusable items
+static void map_64_test() {
+    srand(314);
+    long keys[N];
+    map_64 test = map_new_64(0);
+    for (int i = 0; i < N; i++) {
+        keys[i] = (long)rand() << 31 | rand();
+        map_add_64(&test, keys[i], i);
+    }
+    for (int i = 0; i < N; i += 2) {
+        if (!map_remove_64(&test, keys[i])) THROW_ERR("Key not removed");
+    }
+    for (int i = 0; i < N; i += 4) map_add_64(&test, keys[i], i); // Reuse removed items
+    if (test.length != N / 2 + N / 4) THROW_ERR("Incorrect length");
+    for (int k = 0; k < 2; k++) {
+        map_iter_64 iter = map_iterStart_64();
+        map_kv_64* item;
+        uint64_t count = 0;
+        while ((item = map_iterNext_64(&test, &iter))) {
+            if (item->key != keys[item->value] || item->value % 4 == 2) THROW_ERR("Incorrect item");
+            count++;
+        }
+        if (count != test.length) THROW_ERR("Incorrect length");
+        for (int i = 0; i < N; i++) {
+            if (map_getOrDefault_64(&test, keys[i], -1) != (i % 4 == 2 ? -1 : i)) THROW_ERR("Incorrect value");
+        }
+        map_shrinkToFit_64(&test);
+    }
+    map_free_64(&test);
+}
+
+// Same operations with 32, 16 and 8 bits unsigned sizes
+static void map_16_test() {
+    srand(314);
+    map test = map_new(0);
+    map_16 test16 = map_new_16(0);
+    map_8 test8 = map_new_8(0);
+    for (int i = 0; i < 100 * N; i++) {
+        int key = rand() % (2 * N);
+        if (rand() % 3 == 0) {
+            bool removed = map_remove(&test, key);
+            if ((map_remove_16(&test16, key) != NULL) != removed) THROW_ERR("Incorrect remove");
+            if (key < 120 && (map_remove_8(&test8, key) != NULL) != removed) THROW_ERR("Incorrect remove");
+        }
+        else {
+            bool added = map_tryAdd(&test, key, i);
+            if (map_tryAdd_16(&test16, key, i) != added) THROW_ERR("Incorrect add");
+            if (key < 120 && map_tryAdd_8(&test8, key, i) != added) THROW_ERR("Incorrect add");
+        }
+    }
+    if (test.length != test16.length) THROW_ERR("Incorrect length");
+    map_shrinkToFit_16(&test16);
+    map_shrinkToFit_8(&test8);
+    uint8_t count = 0;
+    map_iter_8 iter = map_iterStart_8();
+    map_kv_8* item;
+    while ((item = map_iterNext_8(&test8, &iter))) {
+        if (item->key >= 120 || map_get(&test, item->key) != item->value) THROW_ERR("Incorrect item");
+        count++;
+    }
+    if (count != test8.length) THROW_ERR("Incorrect length");
+    for (int key = 0; key < 2 * N; key++) {
+        int value = map_getOrDefault(&test, key, -1);
+        if (map_getOrDefault_16(&test16, key, -1) != value) THROW_ERR("Incorrect value");
+        if (key < 120 && map_getOrDefault_8(&test8, key, -1) != value) THROW_ERR("Incorrect value");
+    }
+    map_free(&test);
+    map_free_16(&test16);
+    map_free_8(&test8);
+
+    // Adding more items than the size type can index must fail instead of corrupting the map
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        map_8 full = map_new_8(0);
+        for (int i = 0; i < 256; i++) map_add_8(&full, i, i);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
 }
 
 static void map_benchmark() {
@@ -80,9 +568,333 @@ static void map_benchmark() {
     }
 }
 
+// Same as [map_benchmark] with a map reserved to its final size
+static void map_reserve_benchmark() {
+    srand(314);
+    int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = rand();
+    for (int i = 0; i < 4000; i++) {
+        map test = map_new(1);
+        map_reserve(&test, N);
+        for (int j = 0; j < N; j++) {
+            map_add(&test, keys[j], j);
+        }
+        for (int j = 0; j < N; j++) {
+            map_contains(&test, keys[j]);
+        }
+        for (int j = 0; j < N; j++) {
+            map_remove(&test, keys[j]);
+        }
+        map_free(&test);
+    }
+}
+
+// Intersection of two large sets, compared to iterating and calling [map_contains] for each key
+static void map_set_benchmark() {
+    srand(314);
+    int n = 1 << 23;
+    map_intset a = map_new_intset(n);
+    map_intset b = map_new_intset(n / 2);
+    for (int i = 0; i < n; i++) map_tryAdd_intset(&a, rand());
+    for (int i = 0; i < n / 2; i++) map_tryAdd_intset(&b, i % 2 == 0 ? rand() : rand() | 1 << 30);
+    map_intset result;
+    TIME("Set intersection with map_contains",
+        result = map_new_intset(b.length);
+        map_iter_intset iter = map_iterStart_intset();
+        int* key;
+        while ((key = map_iterNext_intset(&b, &iter))) {
+            if (map_contains_intset(&a, *key)) map_add_intset(&result, *key);
+        }
+    )
+    int length = result.length;
+    map_free_intset(&result);
+    TIME("Set intersection",
+        result = map_intersect_intset(&a, &b);
+    )
+    if (result.length != length) THROW_ERR("Incorrect length");
+    map_free_intset(&result);
+    TIME("Set union",
+        result = map_union_intset(&a, &b);
+    )
+    map_free_intset(&result);
+    TIME("Set difference",
+        result = map_difference_intset(&b, &a);
+    )
+    map_free_intset(&result);
+    map_free_intset(&a);
+    map_free_intset(&b);
+}
+
+// Many maps of a few items, with and without inline items
+static void map_inline_benchmark() {
+    srand(314);
+    int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = rand();
+    long sum = 0;
+    TIME("Small maps",
+        for (int i = 0; i < 1000000; i++) {
+            map test = map_new(0);
+            for (int j = 0; j < 6; j++) map_add(&test, keys[(i + j) % N], j);
+            for (int j = 0; j < 12; j++) sum += map_getOrDefault(&test, keys[(i + j) % N], 0);
+            map_free(&test);
+        }
+    )
+    TIME("Small inline maps",
+        for (int i = 0; i < 1000000; i++) {
+            map_small test = map_new_small(0);
+            for (int j = 0; j < 6; j++) map_add_small(&test, keys[(i + j) % N], j);
+            for (int j = 0; j < 12; j++) sum -= map_getOrDefault_small(&test, keys[(i + j) % N], 0);
+            map_free_small(&test);
+        }
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+}
+
+// Look up large values by key, with and without the values in a separate array
+static void map_soa_benchmark() {
+    int n = 1 << 21;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    map_big big = map_new_big(0);
+    map_bigsoa soa = map_new_bigsoa(0);
+    bigValue value = {};
+    for (int i = 0; i < n; i++) {
+        value.data[0] = i;
+        map_add_big(&big, keys[i], value);
+        map_add_bigsoa(&soa, keys[i], value);
+    }
+    for (int i = 0; i < n; i++) keys[i] = i % 4 == 0 ? keys[i] : rand(); // Mostly missing keys
+    long sum = 0;
+    TIME("Large values search",
+        for (int j = 0; j < 4; j++) {
+            for (int i = 0; i < n; i++) sum += map_contains_big(&big, keys[i]);
+        }
+    )
+    TIME("Large values search with separate values",
+        for (int j = 0; j < 4; j++) {
+            for (int i = 0; i < n; i++) sum -= map_contains_bigsoa(&soa, keys[i]);
+        }
+    )
+    TIME("Large values get",
+        for (int i = 0; i < n; i++) {
+            bigValue* ref = map_ref_big(&big, keys[i]);
+            if (ref) sum += ref->data[0];
+        }
+    )
+    TIME("Large values get with separate values",
+        for (int i = 0; i < n; i++) {
+            bigValue* ref = map_ref_bigsoa(&soa, keys[i]);
+            if (ref) sum -= ref->data[0];
+        }
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    map_free_big(&big);
+    map_free_bigsoa(&soa);
+    free(keys);
+}
+
+// Same map with 32 and 64 bits sizes
+static void map_64_benchmark() {
+    int n = 1 << 23;
+    srand(314);
+    long* keys = malloc(sizeof(long) * n);
+    for (int i = 0; i < n; i++) keys[i] = (long)rand() << 31 | rand();
+    long sum = 0;
+    TIME("Map with 32 bits sizes",
+        map_longhashed test = map_new_longhashed(0);
+        for (int i = 0; i < n; i++) map_add_longhashed(&test, keys[i], i);
+        for (int i = 0; i < n; i++) sum += map_get_longhashed(&test, keys[i]);
+        map_free_longhashed(&test);
+    )
+    TIME("Map with 64 bits sizes",
+        map_64 test64 = map_new_64(0);
+        for (int i = 0; i < n; i++) map_add_64(&test64, keys[i], i);
+        for (int i = 0; i < n; i++) sum -= map_get_64(&test64, keys[i]);
+        map_free_64(&test64);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    free(keys);
+}
+
+// Build a large map with [map_add] compared to [map_fromArrays], then look up all keys in random order
+static void map_fromArrays_benchmark() {
+    int n = 1 << 23;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    int* values = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = rand();
+        values[i] = i;
+    }
+    map test = map_new(1);
+    for (int i = 0; i < n; i++) {
+        if (!map_tryAdd(&test, keys[i], i)) keys[i] = -i - 1;
+    }
+    map_free(&test);
+    int* order = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) order[i] = keys[rand() % n];
+    long sum = 0;
+    TIME("Map add build",
+        test = map_new(1);
+        for (int i = 0; i < n; i++) map_add(&test, keys[i], values[i]);
+    )
+    TIME("Map add lookups",
+        for (int i = 0; i < n; i++) sum += map_get(&test, order[i]);
+    )
+    map_free(&test);
+    TIME("Map fromArrays build",
+        test = map_fromArrays(keys, values, n);
+    )
+    TIME("Map fromArrays lookups",
+        for (int i = 0; i < n; i++) sum -= map_get(&test, order[i]);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    map_free(&test);
+    free(keys);
+    free(values);
+    free(order);
+}
+
+// Look up string keys that are mostly not in a large map, with and without a filter
+static void map_filtered_benchmark() {
+    int n = 1 << 21;
+    char (*strings)[32] = malloc(sizeof(*strings) * n * 2);
+    for (int i = 0; i < 2 * n; i++) snprintf(strings[i], 32, "key %d", i);
+    const char** keys = malloc(sizeof(char*) * n);
+    // 95% of the keys are missing
+    for (int i = 0; i < n; i++) keys[i] = strings[i % 20 == 0 ? i : n + i];
+    int count = 0;
+    map_str test = map_new_str(n);
+    for (int i = 0; i < n; i++) map_add_str(&test, strings[i], i);
+    TIME("Map string contains (95%% missing)",
+        for (int i = 0; i < n; i++) count += map_contains_str(&test, keys[i]);
+    )
+    map_free_str(&test);
+    map_strfiltered filtered = map_new_strfiltered(n);
+    for (int i = 0; i < n; i++) map_add_strfiltered(&filtered, strings[i], i);
+    TIME("Filtered map string contains (95%% missing)",
+        for (int i = 0; i < n; i++) count -= map_contains_strfiltered(&filtered, keys[i]);
+    )
+    if (count != 0) THROW_ERR("Incorrect key");
+    map_free_strfiltered(&filtered);
+    free(keys);
+    free(strings);
+}
+
+// Rebuild a large map with [map_add] compared to mapping a snapshot of it
+static void map_snapshot_benchmark() {
+    int n = 1 << 23;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    map_snap test;
+    TIME("Map rebuild",
+        test = map_new_snap(1);
+        for (int i = 0; i < n; i++) map_tryAdd_snap(&test, keys[i], i);
+    )
+    char path[] = "/tmp/test_mapXXXXXX";
+    THROW_P(int fd = mkstemp(path), fd < 0);
+    map_save_snap(&test, fd);
+    THROW(close(fd));
+    map_free_snap(&test);
+    long sum = 0;
+    TIME("Map mmap",
+        test = map_mmap_snap(path);
+        for (int i = 0; i < 1000; i++) sum += map_getOrDefault_snap(&test, keys[i], 0);
+    )
+    if (sum == 0) THROW_ERR("Incorrect value");
+    map_munmap_snap(&test);
+    THROW(unlink(path));
+    free(keys);
+}
+
+static void map_batch_benchmark() {
+    // Larger than the last level cache
+    int n = 1 << 23;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    int** refs = malloc(sizeof(int*) * n);
+    map test = map_new(1);
+    for (int i = 0; i < n; i++) {
+        keys[i] = rand();
+        map_tryAdd(&test, keys[i], i);
+    }
+    for (int i = 0; i < n; i++) {
+        int j = rand() % n;
+        int key = keys[i];
+        keys[i] = keys[j];
+        keys[j] = key;
+    }
+    long sum = 0;
+    TIME("Map ref loop",
+        for (int i = 0; i < n; i++) refs[i] = map_ref(&test, keys[i]);
+    )
+    for (int i = 0; i < n; i++) sum += *refs[i];
+    TIME("Map refBatch",
+        map_refBatch(&test, keys, n, refs);
+    )
+    for (int i = 0; i < n; i++) sum -= *refs[i];
+    if (sum != 0) THROW_ERR("Incorrect batch ref");
+    map_free(&test);
+    free(keys);
+    free(refs);
+}
+
+// Longest time taken by an insertion while growing a map to a given length
+#define MAP_LATENCY_BENCHMARK(name, suffix, length) { \
+    srand(314); \
+    map##suffix test = map_new##suffix(1); \
+    long maxTime = 0; \
+    for (int i = 0; i < length; i++) { \
+        int key = rand(); \
+        gettimeofday(&_t1, NULL); \
+        map_tryAdd##suffix(&test, key, i); \
+        gettimeofday(&_t2, NULL); \
+        long time = (_t2.tv_sec - _t1.tv_sec) * 1000000 + (_t2.tv_usec - _t1.tv_usec); \
+        if (time > maxTime) maxTime = time; \
+    } \
+    map_free##suffix(&test); \
+    printf(name" : %ld us\n", maxTime); \
+}
+
 int main() {
     TIME("Map benchmark",
         map_benchmark();
     )
+    TIME("Map reserved benchmark",
+        map_reserve_benchmark();
+    )
+    MAP_LATENCY_BENCHMARK("Map max insertion time", , 1 << 23)
+    MAP_LATENCY_BENCHMARK("Incremental map max insertion time", _inc, 1 << 23)
+    map_batch_benchmark();
+    map_snapshot_benchmark();
+    map_filtered_benchmark();
+    map_fromArrays_benchmark();
+    map_inline_benchmark();
+    map_set_benchmark();
+    map_soa_benchmark();
+    map_64_benchmark();
+    char** keys = map_stringKeys();
+    TIME("Map string benchmark",
+        MAP_STRING_TEST(_str, keys, N, 200)
+    )
+    TIME("Map stored hash string benchmark",
+        MAP_STRING_TEST(_strhash, keys, N, 200)
+    )
+    for (int i = 0; i < N; i++) free(keys[i]);
+    free(keys);
     map_test();
+    map_fromArrays_test();
+    map_snapshot_test();
+    map_inc_test();
+    map_load_test();
+    map_range_test();
+    map_filtered_test();
+    map_coarse_test();
+    map_inline_test();
+    map_set_test();
+    map_soa_test();
+    map_64_test();
+    map_16_test();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "./algorithms.h"
 #include "benchmark.h"
+#include "throw.h"
 
 #define MAX_LENGTH 1048576
 
@@ -59,9 +60,41 @@ static void queueest() {
     printf("%ld\n", h);
 }
 
+// Same operations with 32 and unsigned 64 bits sizes
+static void queue_64_test() {
+    srand(314);
+    queue test = queue_new(1);
+    queue_64 test64 = queue_new_64(1);
+    for (int i = 0; i < 1000000; i++) {
+        int r = rand();
+        switch (r & 3) {
+        case 0:
+            queue_addFirst(&test, r);
+            queue_addFirst_64(&test64, r);
+            break;
+        case 1:
+            queue_addLast(&test, r);
+            queue_addLast_64(&test64, r);
+            break;
+        case 2:
+            if (test.length > 0 && queue_popFirst(&test) != queue_popFirst_64(&test64)) THROW_ERR("Incorrect value");
+            break;
+        default:
+            if (test.length > 0 && queue_popLast(&test) != queue_popLast_64(&test64)) THROW_ERR("Incorrect value");
+        }
+        if (test.length != test64.length) THROW_ERR("Incorrect length");
+    }
+    for (uint64_t i = 0; i < test64.length; i++) {
+        if (queue_get(&test, i) != queue_get_64(&test64, i)) THROW_ERR("Incorrect value");
+    }
+    queue_free(&test);
+    queue_free_64(&test64);
+}
+
 int main() {
     TIME("Queue benchmark", 
         queue_benchmark();
     )
     queueest();
+    queue_64_test();
 }
\ No newline at end of file
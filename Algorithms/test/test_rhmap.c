@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "./algorithms.h"
+#include "benchmark.h"
+#include "throw.h"
+
+#define N 10000
+
+static void rhmap_test() {
+    srand(314);
+    int keys[N];
+    rhmap test = rhmap_new(2);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        if (rhmap_contains(&test, keys[i]) || rhmap_ref(&test, keys[i]) != NULL) THROW_ERR("Key already in map");
+        rhmap_add(&test, keys[i], i);
+        keys[++i] = rand();
+        rhmap_setOrAdd(&test, keys[i], i);
+        keys[++i] = rand();
+        if (!rhmap_tryAdd(&test, keys[i], i)) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        bool added;
+        *rhmap_refOrEmpty(&test, keys[i], &added) = i;
+        if (!added) THROW_ERR("Key not added");
+        keys[++i] = rand();
+        rhmap_refOrDefault(&test, keys[i], i, &added);
+        if (!added) THROW_ERR("Key not added");
+    }
+    if (test.length != N) THROW_ERR("Incorrect length");
+    if (rhmap_meanProbe(&test) > 4 || rhmap_maxProbe(&test) > 64) THROW_ERR("Probe distance too long");
+
+    bool found[N] = {};
+    rhmap_iter iter = rhmap_iterStart();
+    rhmap_kv* item;
+    while ((item = rhmap_iterNext(&test, &iter))) {
+        if (item->key != keys[item->value]) THROW_ERR("Incorrect key");
+        found[item->value] = true;
+    }
+    for (int i = 0; i < N; i++) {
+        if (!found[i]) THROW_ERR("Value not found");
+    }
+
+    for (int i = 0; i < N; i++) {
+        if (!rhmap_contains(&test, keys[i])) THROW_ERR("Key not found");
+        if (rhmap_get(&test, keys[i]) != i) THROW_ERR("Incorrect value");
+        if (rhmap_getOrDefault(&test, keys[i], 314) != i) THROW_ERR("Incorrect value");
+        if (*rhmap_ref(&test, keys[i]) != i) THROW_ERR("Incorrect ref");
+        bool added;
+        if (*rhmap_refOrEmpty(&test, keys[i], &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        if (*rhmap_refOrDefault(&test, keys[i], 314, &added) != i) THROW_ERR("Incorrect ref");
+        if (added) THROW_ERR("Key added");
+        int* ref = rhmap_remove(&test, keys[i]);
+        if (!ref) THROW_ERR("Key not found");
+        if (*ref != i) THROW_ERR("Incorrect ref");
+        ref = rhmap_remove(&test, keys[i]);
+        if (ref) THROW_ERR("Key not removed");
+        if (i % 100 == 0 && !rhmap_contains(&test, keys[N - 1])) THROW_ERR("Key lost by removal");
+    }
+    if (test.length != 0) THROW_ERR("Incorrect length");
+    if (rhmap_maxProbe(&test) != 0 || rhmap_meanProbe(&test) != 0) THROW_ERR("Incorrect probe distance");
+
+    for (int i = 0; i < N; i++) { // Backward shift keeps probe distances short under churn
+        rhmap_add(&test, keys[i], i);
+        if (i >= 100 && !rhmap_remove(&test, keys[i - 100])) THROW_ERR("Key not found");
+    }
+    if (test.length != 100) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        if (rhmap_contains(&test, keys[i]) != (i >= N - 100)) THROW_ERR("Incorrect key");
+    }
+
+    rhmap_free(&test);
+
+    test = rhmap_new(0); // Keys colliding in their first slot
+    for (int i = 0; i < 1000; i++) rhmap_add(&test, i << 20, i);
+    for (int i = 0; i < 1000; i++) {
+        if (rhmap_getOrDefault(&test, i << 20, -1) != i) THROW_ERR("Incorrect value");
+    }
+    rhmap_free(&test);
+}
+
+// Unsigned 16 bits sizes: growing past 32768 slots fails, and so does asking for too large a map
+static void rhmap_16_test() {
+    rhmap_16 test = rhmap_new_16(0);
+    for (int i = 0; i < 24576; i++) rhmap_add_16(&test, i, i);
+    if (test.mask != 32767) THROW_ERR("Incorrect slots");
+    for (int i = 0; i < 24576; i++) {
+        if (rhmap_get_16(&test, i) != i) THROW_ERR("Incorrect value");
+    }
+    rhmap_free_16(&test);
+
+    for (int init = 0; init < 2; init++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            freopen("/dev/null", "w", stdout);
+            freopen("/dev/null", "w", stderr);
+            if (init) rhmap_new_16(65000);
+            rhmap_16 full = rhmap_new_16(0);
+            for (int i = 0; i < 65000; i++) rhmap_add_16(&full, i, i);
+            exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
+    }
+}
+
+// Mixed workload compared to [flatmap], and probe distances depending on the load
+
+static void rhmap_benchmark() {
+    srand(314);
+    int keys[N];
+    for (int i = 0; i < N; i++) keys[i] = rand();
+    TIME("Robin Hood map benchmark",
+        for (int i = 0; i < 4000; i++) {
+            rhmap test = rhmap_new(1);
+            for (int j = 0; j < N; j++) rhmap_add(&test, keys[j], j);
+            for (int j = 0; j < N; j++) rhmap_contains(&test, keys[j]);
+            for (int j = 0; j < N; j++) rhmap_remove(&test, keys[j]);
+            rhmap_free(&test);
+        }
+    )
+    TIME("Flat map benchmark",
+        for (int i = 0; i < 4000; i++) {
+            flatmap test = flatmap_new(1);
+            for (int j = 0; j < N; j++) flatmap_add(&test, keys[j], j);
+            for (int j = 0; j < N; j++) flatmap_contains(&test, keys[j]);
+            for (int j = 0; j < N; j++) flatmap_remove(&test, keys[j]);
+            flatmap_free(&test);
+        }
+    )
+
+    // Probe distances just before growing, when the load is the highest
+    int n = 1 << 20;
+    rhmap test = rhmap_new(1);
+    for (int i = 0; i < n; i++) {
+        if (test.length == test.capacity && test.length >= 1 << 14) {
+            printf("%d items, load %.3f : mean probe %.2f, max probe %d\n", test.length,
+                (double)test.length / (test.mask + 1), rhmap_meanProbe(&test), rhmap_maxProbe(&test));
+        }
+        rhmap_tryAdd(&test, rand(), i);
+    }
+    rhmap_free(&test);
+}
+
+int main() {
+    rhmap_benchmark();
+    rhmap_test();
+    rhmap_16_test();
+}
@@ -30,9 +30,21 @@ static void search_test() {
     }
 }
 
+static void search_64_test() {
+    srand(314);
+    static int items[N];
+    for (int i = 0; i < N; i++) items[i] = rand();
+    sort(items, N);
+    for (int i = 0; i < N; i++) {
+        int item = rand();
+        if (search_64(items, item, N) != search(items, item, N)) THROW_ERR("Incorrect index");
+    }
+}
+
 int main() {
     TIME("Search benchmark",
         search_benchmark();
     )
     search_test();
+    search_64_test();
 }
\ No newline at end of file
@@ -44,9 +44,24 @@ static void sort_test(void (*sort)(int* items, int n)) {
     free(copy);
 }
 
+// Unsigned 64 bits sizes, with quick sort and radix sort
+static void sort_64_test() {
+    srand(314);
+    int* items = malloc(sizeof(int) * N);
+    for (uint64_t n = 100; n <= N; n *= 50000) {
+        for (uint64_t i = 0; i < n; i++) items[i] = rand() - rand();
+        sort_64(items, n);
+        for (uint64_t i = 1; i < n; i++) {
+            if (items[i - 1] > items[i]) THROW_ERR("Items not sorted");
+        }
+    }
+    free(items);
+}
+
 int main() {
     TIME("Sort benchmark",
         sort_benchmark(sort);
     )
     sort_test(sort);
+    sort_64_test();
 }
\ No newline at end of file
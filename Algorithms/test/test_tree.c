@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "./algorithms.h"
 #include "benchmark.h"
 #include "throw.h"
@@ -109,6 +111,539 @@ static void tree_test() {
     tree_free(&test);
 }
 
+static void tree_sum(tree_kv* item, void* sum) {
+    *(long*)sum += item->value;
+}
+
+// Ranges with inclusive and exclusive bounds compared to a sorted array of even keys
+static void tree_range_test() {
+    int n = 200;
+    tree test = tree_new(1);
+    for (int i = 0; i < n; i++) tree_tryAdd(&test, 2 * i, i);
+    for (int start = -3; start < 2 * n + 3; start++) {
+        for (int end = start - 3; end < 2 * n + 3; end++) {
+            for (int bounds = 0; bounds < 4; bounds++) {
+                bool startInclusive = bounds & 1, endInclusive = bounds & 2;
+                int first = startInclusive ? start : start + 1;
+                int last = endInclusive ? end : end - 1;
+                first = first < 0 ? 0 : (first + 1) / 2;
+                last = last >= 2 * n ? n - 1 : last < 0 ? -1 : last / 2;
+                tree_iter iter = tree_iterRange(&test, start, startInclusive, end, endInclusive);
+                tree_kv* item;
+                int i = first;
+                while ((item = tree_next(&test, &iter))) {
+                    if (i > last || item->value != i++) THROW_ERR("Incorrect item");
+                }
+                if (i <= last) THROW_ERR("Missing items");
+                long sum = 0;
+                tree_forRange(&test, start, startInclusive, end, endInclusive, tree_sum, &sum);
+                if (sum != (first <= last ? (long)(first + last) * (last - first + 1) / 2 : 0)) THROW_ERR("Incorrect sum");
+            }
+        }
+    }
+    tree_iter iter = tree_iterBefore(&test, 2 * n);
+    for (int i = 0; i < n; i++) {
+        if (!tree_nextBefore(&test, 2 * n, &iter)) THROW_ERR("Missing items");
+    }
+    if (tree_nextBefore(&test, 2 * n, &iter)) THROW_ERR("Incorrect item");
+    if (tree_floor(&test, -1) || tree_ceil(&test, 2 * n)) THROW_ERR("Incorrect bound");
+    tree_free(&test);
+}
+
+// Order statistics compared to a sorted array, after adding and removing items
+static void tree_select_test() {
+    srand(314);
+    int keys[N];
+    tree test = tree_new(1);
+    for (int i = 0; i < N; i++) {
+        keys[i] = rand();
+        tree_tryAdd(&test, keys[i], i);
+    }
+    for (int i = 0; i < N; i += 3) tree_remove(&test, keys[i]);
+    int sortedKeys[N];
+    int n = 0;
+    for (int i = 0; i < N; i++) {
+        if (i % 3 != 0) sortedKeys[n++] = keys[i];
+    }
+    sort(sortedKeys, n);
+    if (test.length != n) THROW_ERR("Incorrect length");
+
+    for (int k = 0; k < n; k++) {
+        tree_kv* item = tree_select(&test, k);
+        if (!item || item->key != sortedKeys[k]) THROW_ERR("Incorrect select");
+        if (tree_rank(&test, sortedKeys[k]) != k) THROW_ERR("Incorrect rank");
+    }
+    if (tree_select(&test, n) || tree_rank(&test, sortedKeys[n - 1] + 1) != n) THROW_ERR("Incorrect select");
+    for (int k = 0; k <= n; k += 97) {
+        tree_iter iter = tree_iterAt(&test, k);
+        tree_kv* item;
+        int j = k;
+        while ((item = tree_next(&test, &iter))) {
+            if (item->key != sortedKeys[j++]) THROW_ERR("Incorrect item");
+        }
+        if (j != n) THROW_ERR("Missing items");
+    }
+    if (tree_percentile(&test, 0)->key != sortedKeys[0] || tree_percentile(&test, 1)->key != sortedKeys[n - 1]) THROW_ERR("Incorrect percentile");
+    if (tree_percentile(&test, 0.5)->key != sortedKeys[(n + 1) / 2 - 1]) THROW_ERR("Incorrect median");
+    if (tree_percentile(&test, 0.99)->key != sortedKeys[(99 * n + 99) / 100 - 1]) THROW_ERR("Incorrect percentile");
+    tree_free(&test);
+}
+
+// Highest bit of a link, for the default 32 bits size
+#define TREE_RED ((int32_t)((uint32_t)1 << 31))
+
+// Check the red-black invariants and the sizes of a sub-tree, return its black height (the root can be red)
+static int tree_check(tree* test, int32_t link, bool parentRed) {
+    if (link == 0) return 1;
+    bool red = link & TREE_RED;
+    if (red && parentRed) THROW_ERR("Red item with a red parent");
+    _tree_item* item = test->items + (link & ~TREE_RED);
+    int height = tree_check(test, item->children[0], red);
+    if (tree_check(test, item->children[1], red) != height) THROW_ERR("Different black heights");
+    int32_t size = 1 + test->items[item->children[0] & ~TREE_RED].size + test->items[item->children[1] & ~TREE_RED].size;
+    if (item->size != size) THROW_ERR("Incorrect size");
+    return height + !red;
+}
+
+// Trees built from sorted arrays of every size up to 1000, then modified
+static void tree_fromSorted_test() {
+    srand(314);
+    int keys[2 * N];
+    int values[2 * N];
+    for (int i = 0; i < 2 * N; i++) {
+        keys[i] = 2 * i;
+        values[i] = i;
+    }
+    for (int n = 0; n <= 2 * N; n += n < 1000 ? 1 : 997) {
+        tree test = tree_fromSorted(keys, values, n);
+        if (test.length != n) THROW_ERR("Incorrect length");
+        tree_check(&test, test.items[0].children[1] & ~TREE_RED, false);
+        tree_iter iter = tree_iterAll();
+        tree_kv* item;
+        int i = 0;
+        while ((item = tree_next(&test, &iter))) {
+            if (item->key != keys[i] || item->value != i) THROW_ERR("Incorrect item");
+            i++;
+        }
+        if (i != n) THROW_ERR("Missing items");
+        for (int k = 0; k < n; k += 7) {
+            if (tree_get(&test, keys[k]) != k || tree_select(&test, k)->key != keys[k]) THROW_ERR("Incorrect item");
+        }
+        for (int k = 0; k < 100; k++) {
+            int key = rand() % (4 * N + 2);
+            if (key % 2 == 0 && rand() % 2 == 0) tree_remove(&test, key);
+            else tree_tryAdd(&test, key, -1);
+        }
+        tree_check(&test, test.items[0].children[1] & ~TREE_RED, false);
+        tree_free(&test);
+    }
+}
+
+// Random tree with keys in [0, range), [ref] contains the value of each key or -1
+static tree tree_random(int* ref, int range, int n, int offset) {
+    tree test = tree_new(1);
+    for (int i = 0; i < range; i++) ref[i] = -1;
+    for (int i = 0; i < n; i++) {
+        int key = rand() % range;
+        if (rand() % 4 == 0) {
+            tree_remove(&test, key);
+            ref[key] = -1;
+        }
+        else {
+            tree_setOrAdd(&test, key, i + offset);
+            ref[key] = i + offset;
+        }
+    }
+    return test;
+}
+
+// Check that a tree contains the items of a reference
+static void tree_compare(tree* test, int* ref, int range) {
+    tree_check(test, test->items[0].children[1] & ~TREE_RED, false);
+    int length = 0;
+    for (int key = 0; key < range; key++) {
+        if (ref[key] != -1) length++;
+        if (tree_getOrDefault(test, key, -1) != ref[key]) THROW_ERR("Incorrect item");
+    }
+    if (test->length != length) THROW_ERR("Incorrect length");
+    tree_iter iter = tree_iterAll();
+    tree_kv* item;
+    int prev = -1;
+    while ((item = tree_next(test, &iter))) {
+        if (item->key <= prev) THROW_ERR("Incorrect order");
+        prev = item->key;
+        length--;
+    }
+    if (length != 0) THROW_ERR("Incorrect iteration");
+}
+
+// Modify a tree after an operation to check its reusable items
+static void tree_modify(tree* test, int* ref, int range) {
+    for (int i = 0; i < 200; i++) {
+        int key = rand() % range;
+        if (rand() % 2 == 0) {
+            tree_remove(test, key);
+            ref[key] = -1;
+        }
+        else if (tree_tryAdd(test, key, -2 - i)) ref[key] = -2 - i;
+    }
+    tree_compare(test, ref, range);
+}
+
+// Union, intersection and difference of random trees compared to a reference, on 1 and 4 threads
+static void tree_setOperations_test() {
+    int* refA = malloc(sizeof(int) * 8 * N);
+    int* refB = malloc(sizeof(int) * 8 * N);
+    int* ref = malloc(sizeof(int) * 8 * N);
+    for (int round = 0; round < 60; round++) {
+        srand(round);
+        int range = 1 + rand() % (8 * N);
+        int na = round % 5 == 0 ? rand() % 10 : rand() % (8 * N);
+        int nb = round % 3 == 0 ? rand() % 100 : rand() % (8 * N);
+        for (int op = 0; op < 3; op++) {
+            for (int threads = 1; threads <= 4; threads += 3) {
+                srand(round + 1000);
+                tree a = tree_random(refA, range, na, 0);
+                tree b = tree_random(refB, range, nb, 10 * N);
+                for (int key = 0; key < range; key++) {
+                    if (op == 0) ref[key] = refB[key] != -1 ? refB[key] : refA[key];
+                    else if (op == 1) ref[key] = refB[key] != -1 ? refA[key] : -1;
+                    else ref[key] = refB[key] != -1 ? -1 : refA[key];
+                }
+                if (op == 0) tree_union(&a, &b, threads);
+                else if (op == 1) tree_intersect(&a, &b, threads);
+                else tree_difference(&a, &b, threads);
+                tree_compare(&a, ref, range);
+                tree_compare(&b, refB, range);
+                tree_modify(&a, ref, range);
+                tree_free(&a);
+                tree_free(&b);
+            }
+        }
+    }
+    free(refA);
+    free(refB);
+    free(ref);
+}
+
+// Split random trees at various keys, then join the parts back
+static void tree_split_test() {
+    int* refA = malloc(sizeof(int) * 2 * N);
+    int* refLeft = malloc(sizeof(int) * 2 * N);
+    int* refRight = malloc(sizeof(int) * 2 * N);
+    for (int round = 0; round < 100; round++) {
+        srand(round);
+        int range = 1 + rand() % (2 * N);
+        tree a = tree_random(refA, range, round % 10 == 0 ? rand() % 5 : rand() % (2 * N), 0);
+        int key = rand() % (range + 2) - 1;
+        for (int i = 0; i < range; i++) {
+            refLeft[i] = i < key ? refA[i] : -1;
+            refRight[i] = i < key ? -1 : refA[i];
+        }
+        tree left, right;
+        tree_split(&a, key, &left, round % 2 == 0 ? &a : &right);
+        if (round % 2 == 0) right = a;
+        tree_compare(&left, refLeft, range);
+        tree_compare(&right, refRight, range);
+        tree_modify(&left, refLeft, key > 0 ? key : 1);
+        tree_compare(&right, refRight, range);
+        tree_union(&right, &left, 2);
+        for (int i = 0; i < range; i++) {
+            if (refLeft[i] != -1) refRight[i] = refLeft[i];
+        }
+        tree_compare(&right, refRight, range);
+        tree_free(&left);
+        tree_free(&right);
+    }
+
+    // Without sizes
+    srand(314);
+    for (int n = 0; n < 300; n++) {
+        tree_set set = tree_new_set(1);
+        for (int i = 0; i < n; i++) tree_tryAdd_set(&set, i);
+        tree_set left, right;
+        int key = rand() % (n + 1);
+        tree_split_set(&set, key, &left, &right);
+        if (left.length != key || right.length != n - key) THROW_ERR("Incorrect split");
+        for (int i = 0; i < n; i++) {
+            if (tree_contains_set(i < key ? &left : &right, i) != true || tree_contains_set(i < key ? &right : &left, i)) THROW_ERR("Incorrect split");
+        }
+        tree_tryAdd_set(&left, -1);
+        tree_tryAdd_set(&right, n);
+        if (left.length != key + 1 || right.length != n - key + 1) THROW_ERR("Incorrect add");
+        tree_free_set(&left);
+        tree_free_set(&right);
+    }
+    free(refA);
+    free(refLeft);
+    free(refRight);
+}
+
+// Sorted batches added to random trees
+static void tree_insertBatch_test() {
+    int* refA = malloc(sizeof(int) * 4 * N);
+    int keys[4 * N];
+    int values[4 * N];
+    for (int round = 0; round < 50; round++) {
+        srand(round);
+        int range = 1 + rand() % (4 * N);
+        tree a = tree_random(refA, range, rand() % (4 * N), 0);
+        int n = 0;
+        for (int key = 0; key < range; key++) {
+            if (rand() % 4 < round % 5) {
+                keys[n] = key;
+                values[n] = 10 * N + n;
+                refA[key] = values[n];
+                n++;
+            }
+        }
+        tree_insertBatch(&a, keys, values, n, 1 + round % 4);
+        tree_compare(&a, refA, range);
+        tree_modify(&a, refA, range);
+        tree_free(&a);
+
+        tree_set set = tree_new_set(1);
+        tree_insertBatch_set(&set, keys, n, 2);
+        tree_insertBatch_set(&set, keys, n / 2, 2);
+        if (set.length != n) THROW_ERR("Incorrect length");
+        for (int i = 0; i < n; i++) {
+            if (!tree_contains_set(&set, keys[i])) THROW_ERR("Missing key");
+        }
+        tree_free_set(&set);
+    }
+    free(refA);
+}
+
+// Same operations with 32 and unsigned 64 bits sizes
+static void tree_64_test() {
+    srand(314);
+    tree test = tree_new(1);
+    tree_64 test64 = tree_new_64(1);
+    for (int i = 0; i < 100 * N; i++) {
+        int key = rand() % (10 * N);
+        if (rand() % 3 == 0) {
+            int* ref = tree_remove(&test, key);
+            int* ref64 = tree_remove_64(&test64, key);
+            if ((ref == NULL) != (ref64 == NULL) || (ref && *ref != *ref64)) THROW_ERR("Incorrect remove");
+        }
+        else if (tree_tryAdd(&test, key, i) != tree_tryAdd_64(&test64, key, i)) THROW_ERR("Incorrect add");
+    }
+    if (test.length != test64.length) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        int start = rand() % (10 * N), end = rand() % (10 * N);
+        if (tree_countBetween(&test, start, end) != tree_countBetween_64(&test64, start, end)) THROW_ERR("Incorrect count");
+    }
+    tree_iter iter = tree_iterAll();
+    tree_iter_64 iter64 = tree_iterAll_64();
+    tree_kv* item;
+    while ((item = tree_nextAll(&test, &iter))) {
+        tree_kv_64* item64 = tree_nextAll_64(&test64, &iter64);
+        if (!item64 || item->key != item64->key || item->value != item64->value) THROW_ERR("Incorrect item");
+    }
+    tree_free(&test);
+    tree_free_64(&test64);
+}
+
+// Same operations with 32 and unsigned 16 bits sizes
+static void tree_16_test() {
+    srand(314);
+    tree test = tree_new(1);
+    tree_16 test16 = tree_new_16(1);
+    for (int i = 0; i < 100 * N; i++) {
+        int key = rand() % (2 * N);
+        if (rand() % 3 == 0) {
+            int* ref = tree_remove(&test, key);
+            int* ref16 = tree_remove_16(&test16, key);
+            if ((ref == NULL) != (ref16 == NULL) || (ref && *ref != *ref16)) THROW_ERR("Incorrect remove");
+        }
+        else if (tree_tryAdd(&test, key, i) != tree_tryAdd_16(&test16, key, i)) THROW_ERR("Incorrect add");
+    }
+    if (test.length != test16.length) THROW_ERR("Incorrect length");
+    for (int i = 0; i < N; i++) {
+        int start = rand() % (2 * N), end = rand() % (2 * N);
+        if (tree_countBetween(&test, start, end) != tree_countBetween_16(&test16, start, end)) THROW_ERR("Incorrect count");
+    }
+    tree_iter iter = tree_iterAll();
+    tree_iter_16 iter16 = tree_iterAll_16();
+    tree_kv* item;
+    while ((item = tree_nextAll(&test, &iter))) {
+        tree_kv_16* item16 = tree_nextAll_16(&test16, &iter16);
+        if (!item16 || item->key != item16->key || item->value != item16->value) THROW_ERR("Incorrect item");
+    }
+    if (tree_nextAll_16(&test16, &iter16)) THROW_ERR("Incorrect item");
+    tree_free(&test);
+    tree_free_16(&test16);
+
+    // Adding more items than the size type can index must fail instead of corrupting the tree
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        tree_16 full = tree_new_16(1);
+        for (int i = 0; i < 1 << 15; i++) tree_tryAdd_16(&full, i, i);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 1) THROW_ERR("Overflow not detected");
+}
+
+// Many small trees with 32 and 16 bits sizes
+static void tree_16_benchmark() {
+    int count = 1 << 14, n = 256;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    long sum = 0;
+    TIME("Small trees with 32 bits sizes",
+        tree* trees = malloc(sizeof(tree) * count);
+        for (int i = 0; i < count; i++) {
+            trees[i] = tree_new(n + 1);
+            for (int j = 0; j < n; j++) tree_tryAdd(&trees[i], keys[j], j);
+        }
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < n; j++) sum += tree_get(&trees[i], keys[j]);
+            tree_free(&trees[i]);
+        }
+        free(trees);
+    )
+    TIME("Small trees with 16 bits sizes",
+        tree_16* trees16 = malloc(sizeof(tree_16) * count);
+        for (int i = 0; i < count; i++) {
+            trees16[i] = tree_new_16(n + 1);
+            for (int j = 0; j < n; j++) tree_tryAdd_16(&trees16[i], keys[j], j);
+        }
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < n; j++) sum -= tree_get_16(&trees16[i], keys[j]);
+            tree_free_16(&trees16[i]);
+        }
+        free(trees16);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    free(keys);
+}
+
+// Short windows at random positions in a large tree
+static void tree_range_benchmark() {
+    int n = 1 << 22;
+    srand(314);
+    tree test = tree_new(n + 1);
+    for (int i = 0; i < n; i++) tree_tryAdd(&test, rand(), i);
+    long sum = 0, sumRange = 0;
+    srand(315);
+    TIME("Tree range iterator",
+        for (int i = 0; i < 1 << 20; i++) {
+            int start = rand();
+            tree_iter iter = tree_iterBetween(&test, start, start + (1 << 12));
+            tree_kv* item;
+            while ((item = tree_nextBetween(&test, start, start + (1 << 12), &iter))) sum += item->value;
+        }
+    )
+    srand(315);
+    TIME("Tree range callback",
+        for (int i = 0; i < 1 << 20; i++) {
+            int start = rand();
+            tree_forRange(&test, start, true, start + (1 << 12), false, tree_sum, &sumRange);
+        }
+    )
+    if (sum != sumRange) THROW_ERR("Incorrect sum");
+    tree_free(&test);
+}
+
+// Median and p99 of a sliding window
+static void tree_percentile_benchmark() {
+    int n = 1 << 21, window = 1 << 16;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) keys[i] = rand();
+    long sum = 0;
+    TIME("Sliding window percentiles",
+        tree test = tree_new(window + 1);
+        for (int i = 0; i < n; i++) {
+            tree_tryAdd(&test, keys[i], i);
+            if (i >= window) {
+                tree_remove(&test, keys[i - window]);
+                sum += tree_percentile(&test, 0.5)->key + tree_percentile(&test, 0.99)->key;
+            }
+        }
+        tree_free(&test);
+    )
+    if (sum == 0) THROW_ERR("Incorrect sum");
+    free(keys);
+}
+
+// Build a large tree from sorted keys with [tree_fromSorted] compared to [tree_tryAdd], then look up all keys
+static void tree_fromSorted_benchmark() {
+    int n = 1 << 22;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    int* values = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = rand();
+        values[i] = i;
+    }
+    sort(keys, n);
+    int distinct = 1;
+    for (int i = 1; i < n; i++) {
+        if (keys[i] != keys[distinct - 1]) keys[distinct++] = keys[i];
+    }
+    n = distinct;
+    long sum = 0;
+    TIME("Tree from sorted keys with tryAdd",
+        tree test = tree_new(1);
+        for (int i = 0; i < n; i++) tree_tryAdd(&test, keys[i], values[i]);
+    )
+    TIME("Tree from sorted keys with fromSorted",
+        tree sorted = tree_fromSorted(keys, values, n);
+    )
+    TIME("Lookups after tryAdd",
+        for (int i = 0; i < n; i++) sum += tree_get(&test, keys[i]);
+    )
+    TIME("Lookups after fromSorted",
+        for (int i = 0; i < n; i++) sum -= tree_get(&sorted, keys[i]);
+    )
+    if (sum != 0) THROW_ERR("Incorrect value");
+    tree_free(&test);
+    tree_free(&sorted);
+    free(keys);
+    free(values);
+}
+
+// Merge a sorted batch into a large tree with [tree_setOrAdd] compared to [tree_insertBatch]
+static void tree_insertBatch_benchmark() {
+    int n = 1 << 22, m = 1 << 20;
+    srand(314);
+    int* keys = malloc(sizeof(int) * n);
+    int* values = malloc(sizeof(int) * n);
+    int* batch = malloc(sizeof(int) * m);
+    for (int i = 0; i < n; i++) {
+        keys[i] = 2 * i;
+        values[i] = i;
+    }
+    for (int i = 0; i < m; i++) batch[i] = 8 * i + 1 + 2 * (rand() % 3);
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    tree test = tree_fromSorted(keys, values, n);
+    tree batched = tree_fromSorted(keys, values, n);
+    tree parallel = tree_fromSorted(keys, values, n);
+    TIME("Batch with setOrAdd",
+        for (int i = 0; i < m; i++) tree_setOrAdd(&test, batch[i], i);
+    )
+    TIME("Batch with insertBatch",
+        tree_insertBatch(&batched, batch, values, m, 1);
+    )
+    TIME("Batch with parallel insertBatch",
+        tree_insertBatch(&parallel, batch, values, m, threads);
+    )
+    if (test.length != n + m || batched.length != n + m || parallel.length != n + m) THROW_ERR("Incorrect length");
+    tree_free(&test);
+    tree_free(&batched);
+    tree_free(&parallel);
+    free(keys);
+    free(values);
+    free(batch);
+}
+
 static void tree_benchmark() {
     srand(314);
     int keys[N];
@@ -132,5 +667,18 @@ int main() {
     TIME("Tree benchmark",
         tree_benchmark();
     )
+    tree_16_benchmark();
+    tree_range_benchmark();
+    tree_percentile_benchmark();
+    tree_fromSorted_benchmark();
+    tree_insertBatch_benchmark();
     tree_test();
+    tree_range_test();
+    tree_select_test();
+    tree_fromSorted_test();
+    tree_setOperations_test();
+    tree_split_test();
+    tree_insertBatch_test();
+    tree_64_test();
+    tree_16_test();
 }
\ No newline at end of file